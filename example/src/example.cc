@@ -15,6 +15,7 @@ struct RenderState {
 
 static bool init();
 static void cleanup();
+static void update(double dt);
 static void display();
 static void reshape(int x, int y);
 static void keyb(unsigned char key, int x, int y);
@@ -28,6 +29,7 @@ static ID3D11Buffer *vbuf;
 static ID3D11Buffer *rstate_buf;
 
 static RenderState rstate;
+static float angle, prev_angle;
 
 int main(int argc, char **argv)
 {
@@ -37,9 +39,11 @@ int main(int argc, char **argv)
 	d3dut_create_window("d3dut example");
 
 	d3dut_display_func(display);
+	d3dut_update_func(update);
 	d3dut_idle_func(d3dut_post_redisplay);
 	d3dut_reshape_func(reshape);
 	d3dut_keyboard_func(keyb);
+	d3dut_state_cache(1);
 
 	if(!init()) {
 		return 1;
@@ -171,29 +175,37 @@ static void set_ortho(float *mat, float aspect)
 	mat[0] = 1.0 / aspect;
 }
 
+static void update(double dt)
+{
+	prev_angle = angle;
+	angle += (float)dt;
+}
+
 static void display()
 {
-	unsigned int msec = timeGetTime();
+	// interpolate between the last two simulation steps
+	float t = (float)d3dut_update_alpha();
+	float cur_angle = prev_angle + (angle - prev_angle) * t;
 
 	float fbcolor[] = {0.2f, 0.2f, 0.2f, 1.0f};
 	d3dut_ctx->ClearRenderTargetView(d3dut_rtview, fbcolor);
 
 	// set render state constant buffer data
 	set_ortho(rstate.projection, (float)width / (float)height);
-	set_rotation_z(rstate.modelview, msec / 1000.0);
+	set_rotation_z(rstate.modelview, cur_angle);
 
 	d3dut_ctx->UpdateSubresource(rstate_buf, 0, 0, &rstate, 0, 0);
-	d3dut_ctx->VSSetConstantBuffers(0, 1, &rstate_buf);
+	d3dut_set_vs_constant_buffers(0, 1, &rstate_buf);
 
 
 	unsigned int stride = sizeof(Vertex);
 	unsigned int offset = 0;
-	d3dut_ctx->IASetVertexBuffers(0, 1, &vbuf, &stride, &offset);
-	d3dut_ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-	d3dut_ctx->IASetInputLayout(vertex_layout);
+	d3dut_set_vertex_buffers(0, 1, &vbuf, &stride, &offset);
+	d3dut_set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	d3dut_set_input_layout(vertex_layout);
 
-	d3dut_ctx->VSSetShader(vsdr, 0, 0);
-	d3dut_ctx->PSSetShader(psdr, 0, 0);
+	d3dut_set_vertex_shader(vsdr);
+	d3dut_set_pixel_shader(psdr);
 
 	d3dut_ctx->Draw(3, 0);
 
@@ -228,6 +240,7 @@ static void keyb(unsigned char key, int x, int y)
 			static bool anim = true;
 			anim = !anim;
 			d3dut_idle_func(anim ? d3dut_post_redisplay : 0);
+			d3dut_update_func(anim ? update : 0);
 		}
 		break;
 	}
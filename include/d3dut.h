@@ -50,7 +50,39 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 enum {
 	D3DUT_WINDOW_WIDTH,
 	D3DUT_WINDOW_HEIGHT,
-	D3DUT_ELAPSED_TIME
+	D3DUT_ELAPSED_TIME,
+
+	D3DUT_STATE_CALLS_ISSUED,
+	D3DUT_STATE_CALLS_SKIPPED,
+
+	D3DUT_RQ_PACKETS,
+	D3DUT_RQ_STATE_CHANGES,
+	D3DUT_RQ_STATE_CHANGES_SAVED,
+
+	D3DUT_CAPTURE_FRAMES,
+	D3DUT_CAPTURE_DROPPED,
+
+	// frame timing statistics, in microseconds
+	D3DUT_FRAME_TIME_MEAN,
+	D3DUT_FRAME_TIME_P50,
+	D3DUT_FRAME_TIME_P99,
+	D3DUT_FRAME_TIME_MAX,
+	D3DUT_DISPLAY_TIME_MEAN,
+	D3DUT_DISPLAY_TIME_P50,
+	D3DUT_DISPLAY_TIME_P99,
+	D3DUT_DISPLAY_TIME_MAX,
+	D3DUT_EVENT_TIME_MEAN,
+	D3DUT_EVENT_TIME_P50,
+	D3DUT_EVENT_TIME_P99,
+	D3DUT_EVENT_TIME_MAX,
+	D3DUT_FRAMES_OVER_BUDGET,
+
+	D3DUT_MEM_ALLOC_COUNT,
+
+	D3DUT_UPDATE_STEPS,
+	D3DUT_UPDATE_STEPS_DROPPED,
+
+	D3DUT_SOFTWARE_DRIVER
 };
 
 enum {
@@ -64,6 +96,65 @@ enum {
 
 enum {D3DUT_DOWN = 0, D3DUT_UP = 1};
 
+// main loop hook events
+enum {
+	D3DUT_HOOK_FRAME,	// once per main loop iteration, before redisplays
+	D3DUT_HOOK_KEY		// key pressed in any window, arg: key code
+};
+
+// input event types for latency statistics
+enum {
+	D3DUT_INPUT_KEYBOARD,
+	D3DUT_INPUT_MOUSE_BUTTON,
+	D3DUT_INPUT_MOUSE_MOTION,
+
+	D3DUT_NUM_INPUT_TYPES
+};
+
+// categories of internal memory allocations
+enum {
+	D3DUT_MEM_WINDOWS,
+	D3DUT_MEM_EVENTS,
+	D3DUT_MEM_GEOMETRY,
+	D3DUT_MEM_RENDER,
+	D3DUT_MEM_CAPTURE,
+	D3DUT_MEM_LOGGING,
+	D3DUT_MEM_MISC,
+	D3DUT_MEM_TEXTURES,
+
+	D3DUT_NUM_MEM_CATEGORIES
+};
+
+// mipmap filters
+enum {
+	D3DUT_MIP_BOX,
+	D3DUT_MIP_TRIANGLE,
+	D3DUT_MIP_KAISER
+};
+
+// block compression formats and modes
+enum {
+	D3DUT_BC1,
+	D3DUT_BC3,
+	D3DUT_BC5
+};
+enum {D3DUT_BC_FAST = 0, D3DUT_BC_QUALITY = 1};
+
+// texture creation flags
+#define D3DUT_TEX_SRGB			1
+#define D3DUT_TEX_NO_MIPMAPS	2
+#define D3DUT_TEX_BC1			4
+#define D3DUT_TEX_BC3			8
+#define D3DUT_TEX_BC5			16
+#define D3DUT_TEX_BC_QUALITY	32
+
+// frame capture image formats
+enum {
+	D3DUT_CAPTURE_PNG,
+	D3DUT_CAPTURE_QOI,
+	D3DUT_CAPTURE_RAW
+};
+
 typedef void (*D3DUT_DisplayFunc)();
 typedef void (*D3DUT_IdleFunc)();
 typedef void (*D3DUT_ReshapeFunc)(int, int);
@@ -74,11 +165,90 @@ typedef void (*D3DUT_SpecialUpFunc)(int, int, int);
 typedef void (*D3DUT_MouseFunc)(int, int, int, int);
 typedef void (*D3DUT_MotionFunc)(int, int);
 typedef void (*D3DUT_PassiveMotionFunc)(int, int);
+typedef void (*D3DUT_DrawFunc)(void*);
+typedef void (*D3DUT_UpdateFunc)(double);
+typedef int (*D3DUT_LoopHookFunc)(int, int, void*);
+typedef void *(*D3DUT_AllocFunc)(size_t size, size_t align, void *cls);
+typedef void (*D3DUT_FreeFunc)(void *ptr, void *cls);
+
+struct D3DUT_MemStats {
+	unsigned long num_allocs, num_frees;
+	size_t bytes, peak_bytes;
+};
+
+// durations in milliseconds
+struct D3DUT_TimeStats {
+	double mean, p50, p99, max;
+	unsigned long count;
+};
+
+struct D3DUT_FrameStats {
+	D3DUT_TimeStats frame;		// time between the start of successive frames
+	D3DUT_TimeStats display;	// time spent in display callbacks
+	D3DUT_TimeStats events;		// time spent processing window events
+	unsigned long frames_over_budget;
+};
+
+#define D3DUT_MESH_MAX_ATTR		8
+
+/* mesh loaded from a d3dut binary mesh file (see the objconv tool). The
+ * layout array can be passed directly to CreateInputLayout.
+ */
+struct D3DUT_Mesh {
+	ID3D11Buffer *vbuf, *ibuf;
+	int nverts, nidx;
+	unsigned int vertex_size;
+	DXGI_FORMAT index_format;
+
+	D3D11_INPUT_ELEMENT_DESC layout[D3DUT_MESH_MAX_ATTR];
+	int num_attr;
+	char semantic[D3DUT_MESH_MAX_ATTR][16];
+
+	float bbox_min[3], bbox_max[3];
+	float bsph_center[3], bsph_radius;
+};
+
+/* view frustum as six normalized planes (a, b, c, d), ordered left, right,
+ * bottom, top, near, far; points with ax + by + cz + d >= 0 are inside.
+ */
+struct D3DUT_Frustum {
+	float plane[6][4];
+};
+
+/* bounding volumes for culling, as separate arrays per component */
+struct D3DUT_Spheres {
+	const float *x, *y, *z, *radius;
+};
+
+struct D3DUT_AABBs {
+	const float *min_x, *min_y, *min_z;
+	const float *max_x, *max_y, *max_z;
+};
+
+/* render queue sort key layout, from most to least significant bits:
+ * pass | depth bucket | shader | material | mesh
+ */
+#define D3DUT_RQ_PASS_BITS		4
+#define D3DUT_RQ_DEPTH_BITS		20
+#define D3DUT_RQ_SHADER_BITS	12
+#define D3DUT_RQ_MATERIAL_BITS	14
+#define D3DUT_RQ_MESH_BITS		14
 
 extern D3DUTAPI ID3D11Device *d3dut_dev;
 extern D3DUTAPI ID3D11DeviceContext *d3dut_ctx;
 extern D3DUTAPI ID3D11RenderTargetView *d3dut_rtview;
 
+/* all memory allocated internally by d3dut goes through these hooks, with
+ * the requested alignment. Blocks are always freed through the hooks which
+ * allocated them, so this may be called at any point; call it before
+ * d3dut_init to cover everything. Passing null hooks restores the default
+ * allocator. Returns 0 on success, -1 on failure.
+ * D3DUT_MEM_ALLOC_COUNT (with d3dut_get) is the total number of allocations
+ * so far, and can be compared across frames to verify they don't allocate.
+ */
+int D3DUTAPI d3dut_set_allocator(D3DUT_AllocFunc alloc, D3DUT_FreeFunc free, void *cls);
+void D3DUTAPI d3dut_get_mem_stats(int category, D3DUT_MemStats *stats);
+
 void D3DUTAPI d3dut_init(int *argc, char **argv);
 void D3DUTAPI d3dut_init_display_mode(unsigned int dmflags);
 void D3DUTAPI d3dut_init_window_size(int xsz, int ysz);
@@ -87,6 +257,8 @@ int D3DUTAPI d3dut_create_window(const char *title);
 void D3DUTAPI d3dut_destroy_window(int win);
 void D3DUTAPI d3dut_set_window(int idx);
 int D3DUTAPI d3dut_get_window();
+// native window handle of a window (-1 for the current one)
+HWND D3DUTAPI d3dut_get_window_handle(int win);
 
 void D3DUTAPI d3dut_display_func(D3DUT_DisplayFunc func);
 void D3DUTAPI d3dut_idle_func(D3DUT_IdleFunc func);
@@ -99,14 +271,162 @@ void D3DUTAPI d3dut_mouse_func(D3DUT_MouseFunc func);
 void D3DUTAPI d3dut_motion_func(D3DUT_MotionFunc func);
 void D3DUTAPI d3dut_passive_motion_func(D3DUT_PassiveMotionFunc func);
 
+/* fixed timestep updates: the update function is called by d3dut_main_loop
+ * with a constant dt (in seconds, default 0.01), as many times as needed to
+ * keep up with real time, but at most max_steps (default 5) times per loop
+ * iteration; any time beyond that is dropped, and counted in
+ * D3DUT_UPDATE_STEPS_DROPPED (d3dut_get). The display function can use
+ * d3dut_update_alpha, the fraction of a step left over after the last update
+ * in [0, 1), to interpolate between the previous and current state.
+ * Redisplays are still requested with d3dut_post_redisplay.
+ */
+void D3DUTAPI d3dut_update_func(D3DUT_UpdateFunc func);
+void D3DUTAPI d3dut_fixed_timestep(double dt, int max_steps);
+double D3DUTAPI d3dut_update_alpha();
+
 void D3DUTAPI d3dut_post_redisplay();
 void D3DUTAPI d3dut_swap_buffers();
 
 void D3DUTAPI d3dut_main_loop();
 
+/* a single main loop hook, for front ends built on top of d3dut, like the
+ * coroutine scheduler in d3dut_coro.h. Called with D3DUT_HOOK_* and an
+ * argument. D3DUT_HOOK_FRAME returns how many milliseconds the main loop may
+ * wait for events before calling it again: 0 to be called again right away,
+ * or -1 for no limit.
+ */
+void D3DUTAPI d3dut_main_loop_hook(D3DUT_LoopHookFunc func, void *cls);
+/* wakes up the main loop if it's waiting for events, so that the hook runs.
+ * Can be called from any thread, e.g. when work the hook waits for is done.
+ */
+void D3DUTAPI d3dut_main_loop_wake();
+
+/* captures every frame presented by the current window to an image file.
+ * The path is a printf format string taking the frame number (e.g.
+ * "frame%05d.png"). Readback and encoding are asynchronous, and frames are
+ * dropped rather than stalling rendering if they can't keep up. The number
+ * of frames written and dropped can be queried with d3dut_get.
+ * Returns 0 on success, -1 on failure.
+ */
+int D3DUTAPI d3dut_capture_start(const char *path, int format);
+void D3DUTAPI d3dut_capture_stop();
+
 int D3DUTAPI d3dut_get(unsigned int what);
 
+/* frame timing statistics, collected by d3dut_main_loop. They may be read
+ * from any thread, but reset only from the main loop thread. Frames taking
+ * longer than the budget (default: 1000/60 ms) are counted as over budget.
+ */
+void D3DUTAPI d3dut_get_frame_stats(D3DUT_FrameStats *stats);
+void D3DUTAPI d3dut_reset_frame_stats();
+void D3DUTAPI d3dut_frame_budget(double msec);
+
+/* input-to-present latency of a window (-1 for the current one), for each
+ * type of input event: the time from the arrival of an event, to the return
+ * of the d3dut_swap_buffers call presenting the first frame drawn after it.
+ * When several events arrive between frames, the oldest one is measured.
+ * Reset along with the frame stats.
+ */
+void D3DUTAPI d3dut_get_input_latency(int win, int type, D3DUT_TimeStats *stats);
+
+/* state binding through the d3dut state cache. With the cache enabled, calls
+ * which would re-bind what's already bound are dropped. If you change any of
+ * this state directly through d3dut_ctx, call d3dut_invalidate_state_cache.
+ * D3DUT_STATE_CALLS_ISSUED/SKIPPED can be queried with d3dut_get.
+ */
+void D3DUTAPI d3dut_state_cache(int enable);
+void D3DUTAPI d3dut_invalidate_state_cache();
+
+void D3DUTAPI d3dut_set_vertex_buffers(unsigned int start, unsigned int count, ID3D11Buffer *const *bufs,
+		const unsigned int *strides, const unsigned int *offsets);
+void D3DUTAPI d3dut_set_input_layout(ID3D11InputLayout *layout);
+void D3DUTAPI d3dut_set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY top);
+void D3DUTAPI d3dut_set_vertex_shader(ID3D11VertexShader *sdr);
+void D3DUTAPI d3dut_set_pixel_shader(ID3D11PixelShader *sdr);
+void D3DUTAPI d3dut_set_vs_constant_buffers(unsigned int start, unsigned int count, ID3D11Buffer *const *bufs);
+void D3DUTAPI d3dut_set_ps_constant_buffers(unsigned int start, unsigned int count, ID3D11Buffer *const *bufs);
+
+/* render queue: submit draw packets in any order during the frame, and
+ * d3dut_rq_flush sorts them by key and calls their draw functions in order.
+ * Fields wider than their bit count are clamped. For back-to-front ordering
+ * pass an inverted depth bucket. Stats of the last flush are available
+ * through d3dut_get (D3DUT_RQ_*).
+ */
+unsigned long long D3DUTAPI d3dut_rq_key(unsigned int pass, unsigned int depth, unsigned int shader,
+		unsigned int material, unsigned int mesh);
+void D3DUTAPI d3dut_rq_submit(unsigned long long key, D3DUT_DrawFunc func, void *cls);
+void D3DUTAPI d3dut_rq_flush();
+
+/* mesh optimization: reorder triangles for the post-transform vertex cache,
+ * then vertices in order of first use (returns the new vertex count), and
+ * analyze the average cache miss ratio (ACMR) and average transform to
+ * vertex ratio (ATVR) of an index buffer for a FIFO cache of a given size.
+ * The built-in shapes are optimized automatically.
+ */
+void D3DUTAPI d3dut_optimize_vertex_cache(unsigned int *indices, int nidx, int nverts);
+int D3DUTAPI d3dut_optimize_vertex_fetch(void *verts, int nverts, int vert_size, unsigned int *indices, int nidx);
+void D3DUTAPI d3dut_analyze_vertex_cache(const unsigned int *indices, int nidx, int nverts, int cache_size,
+		float *acmr, float *atvr);
+
+/* creates an immutable texture from RGBA8 pixels, with its full mip chain
+ * generated on the CPU with the given D3DUT_MIP_* filter (large images are
+ * split across threads). With D3DUT_TEX_SRGB the pixels are taken to be sRGB,
+ * the texture has an _SRGB format, and mipmaps are averaged in linear space.
+ * If alpha_ref is greater than zero, the alpha of each mip level is scaled to
+ * preserve the fraction of pixels passing an alpha test against alpha_ref.
+ * With one of the D3DUT_TEX_BC* flags, every level is block compressed
+ * (fast, or with D3DUT_TEX_BC_QUALITY), which requires xsz and ysz to be
+ * multiples of 4. Returns a shader resource view, or null on failure.
+ */
+ID3D11ShaderResourceView D3DUTAPI *d3dut_create_texture(int xsz, int ysz, const unsigned char *pixels,
+		int filter, unsigned int flags, float alpha_ref);
+
+/* block compression of RGBA8 images: BC1 (RGB), BC3 (RGBA) or BC5 (RG).
+ * d3dut_bc_encode writes d3dut_bc_size bytes of blocks to dest, in row order.
+ * Compressed images can be cached in memory, keyed by a hash of the source
+ * pixels, so recompressing the same image is just a copy; the cache is
+ * disabled by default, d3dut_bc_cache_size sets its maximum size in bytes.
+ */
+size_t D3DUTAPI d3dut_bc_size(int format, int xsz, int ysz);
+void D3DUTAPI d3dut_bc_encode(int format, int mode, int xsz, int ysz, const unsigned char *pixels, void *dest);
+void D3DUTAPI d3dut_bc_cache_size(size_t max_bytes);
+
+/* frustum culling. d3dut_frustum extracts the planes from a combined
+ * projection * view (* world) matrix, stored row major and transforming column
+ * vectors (translation in elements 3, 7, 11), with the D3D 0 to w clip depth.
+ * The cull functions write the indices of the possibly visible volumes to
+ * visible (which needs room for count indices) in increasing order, and
+ * return their number. Volumes crossing a plane are kept. Large batches are
+ * split across threads, and AVX2 is used when available.
+ */
+void D3DUTAPI d3dut_frustum(const float *matrix, D3DUT_Frustum *frustum);
+int D3DUTAPI d3dut_cull_spheres(const D3DUT_Frustum *frustum, const D3DUT_Spheres *spheres, int count, int *visible);
+int D3DUTAPI d3dut_cull_aabbs(const D3DUT_Frustum *frustum, const D3DUT_AABBs *boxes, int count, int *visible);
+
+D3DUT_Mesh D3DUTAPI *d3dut_load_mesh(const char *fname);
+void D3DUTAPI d3dut_free_mesh(D3DUT_Mesh *mesh);
+void D3DUTAPI d3dut_draw_mesh(const D3DUT_Mesh *mesh);
+
+/* built-in shapes are drawn with the currently bound shaders and input
+ * layout. Vertices have a float3 position, float3 normal, and float2
+ * texture coordinates, tightly packed in slot 0.
+ */
 void D3DUTAPI d3dut_solid_sphere(double radius, int slices, int stacks);
+
+/* instanced built-in shapes: draw count copies of the shape with a single
+ * DrawIndexedInstanced call. xforms is an array of count 4x4 row-major
+ * matrices transforming column vectors (translation in elements 3, 7 and 11,
+ * like the matrices of the example program), of which only the top three
+ * rows are used. colors is an array of count RGBA colors, or null for white.
+ * The per-instance data is passed in vertex buffer slot 1, as three float4
+ * matrix rows ("instance_xform" 0-2) and a unorm RGBA color ("instance_color").
+ * d3dut_shape_input_layout returns the input layout for the shape vertices
+ * ("position", "normal", "texcoord"), including the instance data if
+ * instanced is nonzero, and its number of elements.
+ */
+void D3DUTAPI d3dut_solid_sphere_instanced(double radius, int slices, int stacks,
+		const float *xforms, const float *colors, int count);
+int D3DUTAPI d3dut_shape_input_layout(int instanced, const D3D11_INPUT_ELEMENT_DESC **layout);
 // TODO ... more stuff
 
 #endif	// D3DUT_H_
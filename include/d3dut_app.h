@@ -0,0 +1,282 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* Header-only application class with statically dispatched callbacks:
+ *
+ *	class MyApp : public d3dut::App<MyApp> {
+ *	public:
+ *		void display() { ...; swap_buffers(); }
+ *		void keyboard(unsigned char key, int x, int y) { ... }
+ *	};
+ *
+ *	MyApp app;
+ *	app.create_window("title");
+ *	return app.run();
+ *
+ * Handlers are public member functions with the same names and arguments as
+ * the d3dut callbacks (without the _func suffix). Whether each one exists is
+ * detected at compile time: the window procedure and main loop are
+ * instantiated for the derived class, so handlers are called directly and
+ * can be inlined, and missing ones compile away entirely.
+ *
+ * An App drives a single window, and run() replaces d3dut_main_loop. Messages
+ * the App doesn't handle are passed on to d3dut, but input events never
+ * reach it, so input latency statistics and d3dut_coro.h key waits don't
+ * cover App windows, and neither do the frame timing statistics.
+ */
+#ifndef D3DUT_APP_H_
+#define D3DUT_APP_H_
+
+#include <type_traits>
+#include <utility>
+#include "d3dut.h"
+
+namespace d3dut {
+
+namespace detail {
+// return type of the default handlers, marking them as missing
+struct Unhandled {};
+}
+
+template <typename Derived>
+class App {
+private:
+	int win;
+	HWND hwnd;
+	WNDPROC base_proc;
+	int width, height;
+	int mousex, mousey;
+	bool must_redisplay, changed_size;
+
+	Derived &derived() { return *static_cast<Derived*>(this); }
+
+	static LRESULT CALLBACK wndproc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam);
+	LRESULT handle_event(UINT msg, WPARAM wparam, LPARAM lparam);
+	void mouse_event(int bn, bool pressed);
+
+public:
+	/* default handlers, hidden by the ones defined in the derived class. They
+	 * have to be public for the detection to work, and so do the overrides.
+	 */
+	detail::Unhandled display() { return detail::Unhandled(); }
+	detail::Unhandled idle() { return detail::Unhandled(); }
+	detail::Unhandled reshape(int, int) { return detail::Unhandled(); }
+	detail::Unhandled keyboard(unsigned char, int, int) { return detail::Unhandled(); }
+	detail::Unhandled keyboard_up(unsigned char, int, int) { return detail::Unhandled(); }
+	detail::Unhandled special(int, int, int) { return detail::Unhandled(); }
+	detail::Unhandled special_up(int, int, int) { return detail::Unhandled(); }
+	detail::Unhandled mouse(int, int, int, int) { return detail::Unhandled(); }
+	detail::Unhandled motion(int, int) { return detail::Unhandled(); }
+	detail::Unhandled passive_motion(int, int) { return detail::Unhandled(); }
+
+	App();
+
+	int create_window(const char *title);
+	int get_window() const { return win; }
+	int get_width() const { return width; }
+	int get_height() const { return height; }
+
+	void post_redisplay() { must_redisplay = true; }
+	void swap_buffers() { d3dut_swap_buffers(); }
+
+	// runs until the window is closed or PostQuitMessage is called
+	int run();
+};
+
+/* handler detection: the default handlers return detail::Unhandled, so a
+ * handler exists if calling it on the derived class returns anything else.
+ */
+#define D3DUT_APP_HAS(name, args) \
+	!std::is_same<decltype(std::declval<D&>().name args), detail::Unhandled>::value
+
+template <typename D>
+struct AppHandlers {
+	enum {
+		display = D3DUT_APP_HAS(display, ()),
+		idle = D3DUT_APP_HAS(idle, ()),
+		reshape = D3DUT_APP_HAS(reshape, (0, 0)),
+		keyboard = D3DUT_APP_HAS(keyboard, ((unsigned char)0, 0, 0)),
+		keyboard_up = D3DUT_APP_HAS(keyboard_up, ((unsigned char)0, 0, 0)),
+		special = D3DUT_APP_HAS(special, (0, 0, 0)),
+		special_up = D3DUT_APP_HAS(special_up, (0, 0, 0)),
+		mouse = D3DUT_APP_HAS(mouse, (0, 0, 0, 0)),
+		motion = D3DUT_APP_HAS(motion, (0, 0)),
+		passive_motion = D3DUT_APP_HAS(passive_motion, (0, 0))
+	};
+};
+
+#undef D3DUT_APP_HAS
+
+template <typename Derived>
+App<Derived>::App()
+{
+	win = -1;
+	hwnd = 0;
+	base_proc = 0;
+	width = height = 0;
+	mousex = mousey = 0;
+	must_redisplay = changed_size = false;
+}
+
+template <typename Derived>
+int App<Derived>::create_window(const char *title)
+{
+	win = d3dut_create_window(title);
+	hwnd = d3dut_get_window_handle(win);
+	width = d3dut_get(D3DUT_WINDOW_WIDTH);
+	height = d3dut_get(D3DUT_WINDOW_HEIGHT);
+	must_redisplay = changed_size = true;
+
+	// subclass the d3dut window, passing on whatever we don't handle
+	SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR)this);
+	base_proc = (WNDPROC)SetWindowLongPtr(hwnd, GWLP_WNDPROC, (LONG_PTR)wndproc);
+	return win;
+}
+
+template <typename Derived>
+int App<Derived>::run()
+{
+	typedef AppHandlers<Derived> Has;
+	MSG msg;
+
+	for(;;) {
+		if(Has::reshape && changed_size) {
+			changed_size = false;
+			d3dut_set_window(win);
+			derived().reshape(width, height);
+		}
+
+		if(Has::idle || must_redisplay) {
+			while(PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
+				if(msg.message == WM_QUIT) {
+					return (int)msg.wParam;
+				}
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+			}
+			if(Has::idle) {
+				derived().idle();
+			}
+		} else {
+			if(!GetMessage(&msg, 0, 0, 0)) {
+				return (int)msg.wParam;
+			}
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+		}
+
+		if(Has::display && must_redisplay) {
+			must_redisplay = false;
+			d3dut_set_window(win);
+			derived().display();
+			ValidateRect(hwnd, 0);
+		}
+	}
+}
+
+template <typename Derived>
+LRESULT CALLBACK App<Derived>::wndproc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
+{
+	App *app = (App*)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+	return app->handle_event(msg, wparam, lparam);
+}
+
+template <typename Derived>
+LRESULT App<Derived>::handle_event(UINT msg, WPARAM wparam, LPARAM lparam)
+{
+	typedef AppHandlers<Derived> Has;
+
+	switch(msg) {
+	case WM_PAINT:
+		must_redisplay = true;
+		ValidateRect(hwnd, 0);
+		return 0;
+
+	case WM_SIZE:
+		width = LOWORD(lparam);
+		height = HIWORD(lparam);
+		changed_size = true;
+		break;	// d3dut keeps track of the size too
+
+	case WM_KEYDOWN:
+		if(wparam < 256) {
+			if(Has::keyboard) derived().keyboard((unsigned char)wparam, mousex, mousey);
+		} else {
+			if(Has::special) derived().special((int)wparam, mousex, mousey);
+		}
+		return 0;
+
+	case WM_KEYUP:
+		if(wparam < 256) {
+			if(Has::keyboard_up) derived().keyboard_up((unsigned char)wparam, mousex, mousey);
+		} else {
+			if(Has::special_up) derived().special_up((int)wparam, mousex, mousey);
+		}
+		return 0;
+
+	case WM_MOUSEMOVE:
+		mousex = LOWORD(lparam);
+		mousey = HIWORD(lparam);
+
+		if(wparam & (MK_LBUTTON | MK_MBUTTON | MK_RBUTTON)) {
+			if(Has::motion) derived().motion(mousex, mousey);
+		} else {
+			if(Has::passive_motion) derived().passive_motion(mousex, mousey);
+		}
+		return 0;
+
+	case WM_LBUTTONDOWN:
+		mouse_event(D3DUT_LEFT_BUTTON, true);
+		return 0;
+	case WM_RBUTTONDOWN:
+		mouse_event(D3DUT_RIGHT_BUTTON, true);
+		return 0;
+	case WM_MBUTTONDOWN:
+		mouse_event(D3DUT_MIDDLE_BUTTON, true);
+		return 0;
+	case WM_LBUTTONUP:
+		mouse_event(D3DUT_LEFT_BUTTON, false);
+		return 0;
+	case WM_RBUTTONUP:
+		mouse_event(D3DUT_RIGHT_BUTTON, false);
+		return 0;
+	case WM_MBUTTONUP:
+		mouse_event(D3DUT_MIDDLE_BUTTON, false);
+		return 0;
+
+	case WM_MOUSEWHEEL:
+		mouse_event(GET_WHEEL_DELTA_WPARAM(wparam) < 0 ? D3DUT_WHEELDOWN_BUTTON : D3DUT_WHEELUP_BUTTON, true);
+		return 0;
+
+	default:
+		break;
+	}
+
+	return CallWindowProc(base_proc, hwnd, msg, wparam, lparam);
+}
+
+template <typename Derived>
+void App<Derived>::mouse_event(int bn, bool pressed)
+{
+	if(AppHandlers<Derived>::mouse) {
+		derived().mouse(bn, pressed ? D3DUT_DOWN : D3DUT_UP, mousex, mousey);
+	}
+}
+
+}	// namespace d3dut
+
+#endif	// D3DUT_APP_H_
@@ -0,0 +1,538 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* Optional C++20 coroutine front end for d3dut. Tasks are started by calling
+ * a coroutine returning d3dut::Task, run until their first co_await, and from
+ * then on are resumed by d3dut_main_loop:
+ *
+ *	d3dut::Task intro()
+ *	{
+ *		show_title();
+ *		int key = co_await d3dut::key_pressed();	// any key
+ *		co_await d3dut::sleep(500);
+ *		std::vector<char> level = co_await d3dut::load_file("level1.dat");
+ *		for(;;) {
+ *			animate();
+ *			co_await d3dut::next_frame();
+ *		}
+ *	}
+ *
+ * Coroutine frames are allocated from a pooled arena, and waiting tasks are
+ * kept in intrusive lists inside their own frames, so starting, suspending
+ * and finishing tasks doesn't touch the heap in steady state; only the file
+ * contents returned by load_file are allocated. Files are read by a single
+ * loader thread, started on the first load and joined at exit. Everything
+ * here must be used only from the main loop thread.
+ *
+ * While tasks only wait for timers, loads or keys, the main loop keeps
+ * waiting for events: the scheduler gives it the time until the next timer
+ * expires, and the loader wakes it up when a file is done.
+ *
+ * The scheduler installs itself with d3dut_main_loop_hook when the first task
+ * suspends, so it can't be combined with another main loop hook. The d3dut
+ * library itself doesn't need C++20, only the code including this header.
+ */
+#ifndef D3DUT_CORO_H_
+#define D3DUT_CORO_H_
+
+#if !defined(__cpp_impl_coroutine) || __cpp_impl_coroutine < 201902L
+#error "d3dut_coro.h requires a compiler with C++20 coroutine support"
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "d3dut.h"
+
+namespace d3dut {
+
+namespace detail {
+
+/* Coroutine frame arena: power of two size classes from 64 bytes to 8kb,
+ * carved out of 64kb chunks and recycled through per-class free lists. Larger
+ * frames fall back to operator new. Chunks are never released.
+ */
+class FrameArena {
+	static const size_t MIN_SHIFT = 6;
+	static const size_t NUM_CLASSES = 8;
+	static const size_t CHUNK_SIZE = 65536;
+
+	struct FreeBlock {
+		FreeBlock *next;
+	};
+
+	FreeBlock *free_list[NUM_CLASSES];
+	char *chunk_ptr, *chunk_end;
+
+	static int size_class(size_t sz)
+	{
+		size_t bsz = (size_t)1 << MIN_SHIFT;
+		for(int i=0; i<(int)NUM_CLASSES; i++) {
+			if(sz <= bsz) return i;
+			bsz <<= 1;
+		}
+		return -1;
+	}
+
+public:
+	FrameArena() : chunk_ptr(0), chunk_end(0)
+	{
+		for(size_t i=0; i<NUM_CLASSES; i++) {
+			free_list[i] = 0;
+		}
+	}
+
+	void *alloc(size_t sz)
+	{
+		int cls = size_class(sz);
+		if(cls < 0) {
+			return ::operator new(sz);
+		}
+
+		if(free_list[cls]) {
+			FreeBlock *b = free_list[cls];
+			free_list[cls] = b->next;
+			return b;
+		}
+
+		size_t bsz = (size_t)1 << (cls + MIN_SHIFT);
+		if(chunk_end - chunk_ptr < (ptrdiff_t)bsz) {
+			// the tail of the previous chunk is lost, at most 8kb
+			chunk_ptr = (char*)::operator new(CHUNK_SIZE);
+			chunk_end = chunk_ptr + CHUNK_SIZE;
+		}
+		void *res = chunk_ptr;
+		chunk_ptr += bsz;
+		return res;
+	}
+
+	void free(void *ptr, size_t sz)
+	{
+		int cls = size_class(sz);
+		if(cls < 0) {
+			::operator delete(ptr);
+			return;
+		}
+		FreeBlock *b = (FreeBlock*)ptr;
+		b->next = free_list[cls];
+		free_list[cls] = b;
+	}
+};
+
+inline FrameArena &frame_arena()
+{
+	static FrameArena arena;
+	return arena;
+}
+
+// awaiters of suspended tasks, linked in place inside the coroutine frames
+struct Waiter {
+	std::coroutine_handle<> coro;
+	Waiter *next;
+};
+
+struct TimerWaiter : Waiter {
+	std::chrono::steady_clock::time_point deadline;
+};
+
+struct KeyWaiter : Waiter {
+	int key;		// -1 for any key
+	int pressed;
+};
+
+struct LoadWaiter : Waiter {
+	const char *path;		// not copied, see load_file
+	std::vector<char> data;
+	std::atomic<bool> done;
+	LoadWaiter *load_next;	// loader queue link, next is the scheduler's
+};
+
+/* persistent file loading thread, fed through an intrusive FIFO of waiters.
+ * Loads still queued at exit are abandoned, along with their tasks.
+ */
+class Loader {
+	std::mutex mutex;
+	std::condition_variable cond;
+	LoadWaiter *head, *tail;
+	std::thread thread;
+	bool quit;
+
+	static void load(LoadWaiter *w)
+	{
+		FILE *fp = fopen(w->path, "rb");
+		if(fp) {
+			if(fseek(fp, 0, SEEK_END) == 0) {
+				long sz = ftell(fp);
+				if(sz > 0) {
+					w->data.resize(sz);
+					rewind(fp);
+					if(fread(&w->data[0], 1, sz, fp) != (size_t)sz) {
+						w->data.clear();
+					}
+				}
+			}
+			fclose(fp);
+		}
+		// the waiter may be gone as soon as this is set
+		w->done.store(true, std::memory_order_release);
+		d3dut_main_loop_wake();
+	}
+
+	void thread_func()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for(;;) {
+			while(!quit && !head) {
+				cond.wait(lock);
+			}
+			if(quit) return;
+
+			LoadWaiter *w = head;
+			head = w->load_next;
+			if(!head) tail = 0;
+
+			lock.unlock();
+			load(w);
+			lock.lock();
+		}
+	}
+
+public:
+	Loader() : head(0), tail(0), quit(false) {}
+
+	~Loader()
+	{
+		if(thread.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				quit = true;
+			}
+			cond.notify_one();
+			thread.join();
+		}
+	}
+
+	void push(LoadWaiter *w)
+	{
+		w->load_next = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if(tail) {
+				tail->load_next = w;
+			} else {
+				head = w;
+			}
+			tail = w;
+
+			if(!thread.joinable()) {
+				thread = std::thread(&Loader::thread_func, this);
+			}
+		}
+		cond.notify_one();
+	}
+};
+
+inline Loader &loader()
+{
+	static Loader ldr;
+	return ldr;
+}
+
+class Scheduler {
+	Waiter *frame_waiters;
+	TimerWaiter *timer_waiters;
+	KeyWaiter *key_waiters;
+	LoadWaiter *load_waiters;
+	bool installed;
+
+	template <typename T>
+	static void push(T *&list, T *w)
+	{
+		w->next = list;
+		list = w;
+	}
+
+	static int hook(int what, int arg, void *cls)
+	{
+		Scheduler *sched = (Scheduler*)cls;
+		switch(what) {
+		case D3DUT_HOOK_FRAME:
+			sched->run_frame();
+			break;
+		case D3DUT_HOOK_KEY:
+			sched->run_key(arg);
+			break;
+		}
+		return sched->wait_msec();
+	}
+
+	void install()
+	{
+		if(!installed) {
+			d3dut_main_loop_hook(hook, this);
+			installed = true;
+		}
+	}
+
+public:
+	Scheduler() : frame_waiters(0), timer_waiters(0), key_waiters(0), load_waiters(0), installed(false) {}
+
+	void wait_frame(Waiter *w)
+	{
+		install();
+		push(frame_waiters, w);
+	}
+
+	void wait_timer(TimerWaiter *w)
+	{
+		install();
+		push(timer_waiters, w);
+	}
+
+	void wait_key(KeyWaiter *w)
+	{
+		install();
+		push(key_waiters, w);
+	}
+
+	void wait_load(LoadWaiter *w)
+	{
+		install();
+		push(load_waiters, w);
+	}
+
+	/* how long the main loop may wait for events: not at all for frame
+	 * waiters, until the earliest timer deadline, and without a limit for
+	 * keys and loads, since the loader wakes the loop up.
+	 */
+	int wait_msec() const
+	{
+		if(frame_waiters) return 0;
+		if(!timer_waiters) return -1;
+
+		std::chrono::steady_clock::time_point first = timer_waiters->deadline;
+		for(TimerWaiter *w=(TimerWaiter*)timer_waiters->next; w; w=(TimerWaiter*)w->next) {
+			if(w->deadline < first) first = w->deadline;
+		}
+
+		std::chrono::steady_clock::duration left = first - std::chrono::steady_clock::now();
+		if(left <= std::chrono::steady_clock::duration::zero()) return 0;
+		// rounded up, so the loop doesn't wake up just before the deadline
+		return (int)std::chrono::ceil<std::chrono::milliseconds>(left).count();
+	}
+
+	/* resumed tasks may suspend again and re-link their waiters, so each list
+	 * is detached before resuming anything, and the next pointer of a waiter
+	 * is read before resuming it, since its frame might be gone afterwards.
+	 */
+	void run_frame()
+	{
+		Waiter *w = frame_waiters;
+		frame_waiters = 0;
+		while(w) {
+			Waiter *next = w->next;
+			w->coro.resume();
+			w = next;
+		}
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		TimerWaiter *tw = timer_waiters;
+		timer_waiters = 0;
+		TimerWaiter *expired = 0;
+		while(tw) {
+			TimerWaiter *next = (TimerWaiter*)tw->next;
+			if(tw->deadline <= now) {
+				push(expired, tw);
+			} else {
+				push(timer_waiters, tw);
+			}
+			tw = next;
+		}
+		while(expired) {
+			TimerWaiter *next = (TimerWaiter*)expired->next;
+			expired->coro.resume();
+			expired = next;
+		}
+
+		LoadWaiter *lw = load_waiters;
+		load_waiters = 0;
+		LoadWaiter *loaded = 0;
+		while(lw) {
+			LoadWaiter *next = (LoadWaiter*)lw->next;
+			if(lw->done.load(std::memory_order_acquire)) {
+				push(loaded, lw);
+			} else {
+				push(load_waiters, lw);
+			}
+			lw = next;
+		}
+		while(loaded) {
+			LoadWaiter *next = (LoadWaiter*)loaded->next;
+			loaded->coro.resume();
+			loaded = next;
+		}
+	}
+
+	void run_key(int key)
+	{
+		KeyWaiter *kw = key_waiters;
+		key_waiters = 0;
+		KeyWaiter *matched = 0;
+		while(kw) {
+			KeyWaiter *next = (KeyWaiter*)kw->next;
+			if(kw->key == -1 || kw->key == key) {
+				kw->pressed = key;
+				push(matched, kw);
+			} else {
+				push(key_waiters, kw);
+			}
+			kw = next;
+		}
+		while(matched) {
+			KeyWaiter *next = (KeyWaiter*)matched->next;
+			matched->coro.resume();
+			matched = next;
+		}
+	}
+};
+
+inline Scheduler &scheduler()
+{
+	static Scheduler sched;
+	return sched;
+}
+
+}	// namespace detail
+
+/* return type of task coroutines. Tasks start immediately, are owned by the
+ * scheduler once they suspend, and free themselves when they finish.
+ */
+struct Task {
+	struct promise_type {
+		Task get_return_object() { return Task(); }
+		std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+		std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+
+		static void *operator new(size_t sz)
+		{
+			return detail::frame_arena().alloc(sz);
+		}
+		static void operator delete(void *ptr, size_t sz)
+		{
+			detail::frame_arena().free(ptr, sz);
+		}
+	};
+};
+
+// resume at the next iteration of the main loop
+inline auto next_frame()
+{
+	struct Awaiter {
+		detail::Waiter w;
+
+		bool await_ready() const { return false; }
+		void await_suspend(std::coroutine_handle<> h)
+		{
+			w.coro = h;
+			detail::scheduler().wait_frame(&w);
+		}
+		void await_resume() const {}
+	};
+	return Awaiter();
+}
+
+// resume at the first main loop iteration after at least msec milliseconds
+inline auto sleep(unsigned int msec)
+{
+	struct Awaiter {
+		detail::TimerWaiter w;
+
+		bool await_ready() const { return false; }
+		void await_suspend(std::coroutine_handle<> h)
+		{
+			w.coro = h;
+			detail::scheduler().wait_timer(&w);
+		}
+		void await_resume() const {}
+	};
+	Awaiter res;
+	res.w.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(msec);
+	return res;
+}
+
+/* resume when a key is pressed in any window: a specific key code, or any key
+ * if -1. Evaluates to the key code.
+ */
+inline auto key_pressed(int key = -1)
+{
+	struct Awaiter {
+		detail::KeyWaiter w;
+
+		bool await_ready() const { return false; }
+		void await_suspend(std::coroutine_handle<> h)
+		{
+			w.coro = h;
+			detail::scheduler().wait_key(&w);
+		}
+		int await_resume() const { return w.pressed; }
+	};
+	Awaiter res;
+	res.w.key = key;
+	res.w.pressed = -1;
+	return res;
+}
+
+/* load a whole file on the loader thread, resuming at the first main loop
+ * iteration after it's done. Loads are done one at a time, in the order they
+ * were requested. Evaluates to the file contents, or an empty vector on
+ * failure. The path isn't copied; it must stay valid until the load is done,
+ * which is the case for a temporary in the co_await expression.
+ */
+class load_file {
+	detail::LoadWaiter w;
+
+public:
+	explicit load_file(const char *path)
+	{
+		w.path = path;
+		w.done.store(false, std::memory_order_relaxed);
+	}
+
+	bool await_ready() const { return false; }
+	void await_suspend(std::coroutine_handle<> h)
+	{
+		w.coro = h;
+		detail::scheduler().wait_load(&w);
+		detail::loader().push(&w);
+	}
+	std::vector<char> await_resume() { return std::move(w.data); }
+};
+
+}	// namespace d3dut
+
+#endif	// D3DUT_CORO_H_
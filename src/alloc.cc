@@ -0,0 +1,181 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include "alloc.h"
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+// the minimum alignment of all blocks
+#define MIN_ALIGN		8
+#define MAX_ALLOCATORS	16
+
+struct Allocator {
+	MemAllocFunc alloc;
+	MemFreeFunc free;
+	void *cls;
+};
+
+/* stored right before each block, so that it can be released through the
+ * same hooks it was allocated with, and accounted for correctly.
+ */
+struct MemHeader {
+	void *base;
+	size_t size;
+	unsigned short cat;
+	unsigned short alloc_idx;
+};
+
+struct MemCounters {
+	std::atomic<unsigned long> num_allocs, num_frees;
+	std::atomic<size_t> bytes, peak_bytes;
+};
+
+static void *def_alloc(size_t size, size_t align, void *cls);
+static void def_free(void *ptr, void *cls);
+
+static Allocator allocators[MAX_ALLOCATORS] = {{def_alloc, def_free, 0}};
+static int num_allocators = 1;
+static std::atomic<int> cur_alloc;
+static std::mutex set_mutex;
+
+static MemCounters counters[NUM_MEM_CATEGORIES];
+
+bool mem_set_allocator(MemAllocFunc alloc, MemFreeFunc free, void *cls)
+{
+	if(!alloc || !free) {
+		cur_alloc = 0;
+		return true;
+	}
+
+	std::lock_guard<std::mutex> lock(set_mutex);
+
+	// reuse the slot if these hooks were used before
+	for(int i=1; i<num_allocators; i++) {
+		Allocator *a = allocators + i;
+		if(a->alloc == alloc && a->free == free && a->cls == cls) {
+			cur_alloc = i;
+			return true;
+		}
+	}
+
+	if(num_allocators >= MAX_ALLOCATORS) {
+		return false;
+	}
+	Allocator *a = allocators + num_allocators;
+	a->alloc = alloc;
+	a->free = free;
+	a->cls = cls;
+	cur_alloc = num_allocators++;
+	return true;
+}
+
+void *mem_alloc(size_t size, int cat, size_t align)
+{
+	if(align < MIN_ALIGN) align = MIN_ALIGN;
+
+	size_t hdr_size = (sizeof(MemHeader) + align - 1) & ~(align - 1);
+
+	int aidx = cur_alloc;
+	Allocator *a = allocators + aidx;
+	char *base = (char*)a->alloc(size + hdr_size, align, a->cls);
+	if(!base) {
+		throw std::bad_alloc();
+	}
+
+	char *ptr = base + hdr_size;
+	MemHeader *hdr = (MemHeader*)ptr - 1;
+	hdr->base = base;
+	hdr->size = size;
+	hdr->cat = (unsigned short)cat;
+	hdr->alloc_idx = (unsigned short)aidx;
+
+	MemCounters *cnt = counters + cat;
+	cnt->num_allocs++;
+	size_t bytes = cnt->bytes += size;
+	size_t peak = cnt->peak_bytes.load(std::memory_order_relaxed);
+	while(bytes > peak && !cnt->peak_bytes.compare_exchange_weak(peak, bytes));
+	return ptr;
+}
+
+void mem_free(void *ptr)
+{
+	if(!ptr) return;
+
+	MemHeader *hdr = (MemHeader*)ptr - 1;
+	MemCounters *cnt = counters + hdr->cat;
+	cnt->num_frees++;
+	cnt->bytes -= hdr->size;
+
+	Allocator *a = allocators + hdr->alloc_idx;
+	a->free(hdr->base, a->cls);
+}
+
+void mem_get_stats(int cat, MemStats *stats)
+{
+	memset(stats, 0, sizeof *stats);
+	if(cat < 0 || cat >= NUM_MEM_CATEGORIES) {
+		return;
+	}
+
+	MemCounters *cnt = counters + cat;
+	stats->num_allocs = cnt->num_allocs;
+	stats->num_frees = cnt->num_frees;
+	stats->bytes = cnt->bytes;
+	stats->peak_bytes = cnt->peak_bytes;
+}
+
+unsigned long mem_total_allocs()
+{
+	unsigned long total = 0;
+	for(int i=0; i<NUM_MEM_CATEGORIES; i++) {
+		total += counters[i].num_allocs;
+	}
+	return total;
+}
+
+char *mem_strdup(const char *s, int cat)
+{
+	size_t len = strlen(s);
+	char *res = (char*)mem_alloc(len + 1, cat);
+	memcpy(res, s, len + 1);
+	return res;
+}
+
+static void *def_alloc(size_t size, size_t align, void *cls)
+{
+#ifdef _MSC_VER
+	return _aligned_malloc(size, align);
+#else
+	void *ptr;
+	return posix_memalign(&ptr, align, size) == 0 ? ptr : 0;
+#endif
+}
+
+static void def_free(void *ptr, void *cls)
+{
+#ifdef _MSC_VER
+	_aligned_free(ptr);
+#else
+	free(ptr);
+#endif
+}
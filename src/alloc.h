@@ -0,0 +1,141 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_ALLOC_H_
+#define D3DUT_ALLOC_H_
+
+#include <stddef.h>
+#include <new>
+#include <utility>
+#include <vector>
+
+/* allocation categories, must match D3DUT_MEM_* in d3dut.h. This header is
+ * kept independent of d3dut.h so that the tools can share internal modules.
+ */
+enum {
+	MEM_WINDOWS,
+	MEM_EVENTS,
+	MEM_GEOMETRY,
+	MEM_RENDER,
+	MEM_CAPTURE,
+	MEM_LOGGING,
+	MEM_MISC,
+	MEM_TEXTURES,
+
+	NUM_MEM_CATEGORIES
+};
+
+#ifdef _MSC_VER
+#define ALIGNOF(T)	__alignof(T)
+#else
+#define ALIGNOF(T)	__alignof__(T)
+#endif
+
+typedef void *(*MemAllocFunc)(size_t, size_t, void*);
+typedef void (*MemFreeFunc)(void*, void*);
+
+struct MemStats {
+	unsigned long num_allocs, num_frees;
+	size_t bytes, peak_bytes;
+};
+
+/* blocks are always released through the hooks which allocated them, so the
+ * allocator can be changed at any time. Returns false if it can't.
+ */
+bool mem_set_allocator(MemAllocFunc alloc, MemFreeFunc free, void *cls);
+
+void *mem_alloc(size_t size, int cat, size_t align = 0);
+void mem_free(void *ptr);
+
+void mem_get_stats(int cat, MemStats *stats);
+unsigned long mem_total_allocs();
+
+template <typename T>
+T *mem_new(int cat)
+{
+	void *ptr = mem_alloc(sizeof(T), cat, ALIGNOF(T));
+	return new(ptr) T;
+}
+
+template <typename T>
+void mem_delete(T *ptr)
+{
+	if(ptr) {
+		ptr->~T();
+		mem_free(ptr);
+	}
+}
+
+char *mem_strdup(const char *s, int cat);
+
+// STL allocator routing container storage through mem_alloc
+template <typename T, int CAT>
+class MemAllocator {
+public:
+	typedef T value_type;
+	typedef T *pointer;
+	typedef const T *const_pointer;
+	typedef T &reference;
+	typedef const T &const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <typename U>
+	struct rebind {
+		typedef MemAllocator<U, CAT> other;
+	};
+
+	MemAllocator() {}
+	template <typename U>
+	MemAllocator(const MemAllocator<U, CAT>&) {}
+
+	pointer address(reference x) const { return &x; }
+	const_pointer address(const_reference x) const { return &x; }
+
+	pointer allocate(size_type n, const void *hint = 0)
+	{
+		return (pointer)mem_alloc(n * sizeof(T), CAT, ALIGNOF(T));
+	}
+
+	void deallocate(pointer p, size_type n)
+	{
+		mem_free(p);
+	}
+
+	size_type max_size() const { return (size_t)-1 / sizeof(T); }
+
+	template <typename U>
+	void construct(U *p) { new((void*)p) U(); }
+	template <typename U, typename V>
+	void construct(U *p, V &&val) { new((void*)p) U(std::forward<V>(val)); }
+
+	template <typename U>
+	void destroy(U *p) { p->~U(); }
+};
+
+template <typename T, typename U, int CAT>
+inline bool operator ==(const MemAllocator<T, CAT>&, const MemAllocator<U, CAT>&) { return true; }
+template <typename T, typename U, int CAT>
+inline bool operator !=(const MemAllocator<T, CAT>&, const MemAllocator<U, CAT>&) { return false; }
+
+// no template aliases in VC2012, hence MemVector<T, CAT>::type
+template <typename T, int CAT>
+struct MemVector {
+	typedef std::vector<T, MemAllocator<T, CAT> > type;
+};
+
+#endif	// D3DUT_ALLOC_H_
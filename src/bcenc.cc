@@ -0,0 +1,648 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include <math.h>
+#include <mutex>
+#include <emmintrin.h>
+#include "bcenc.h"
+#include "thrpool.h"
+#include "alloc.h"
+
+// images with at least this many blocks are split across threads
+#define PAR_BC_THRES	4096
+
+struct BCJob {
+	int fmt;
+	bool quality;
+	int xsz, ysz;
+	const unsigned char *pixels;
+	unsigned char *dest;
+	int bw, bh;		// size in blocks
+	int rows_per_job;
+};
+
+struct CacheEntry {
+	unsigned long long hash;
+	int fmt;
+	bool quality;
+	int xsz, ysz;
+	size_t size;
+	unsigned char *data;
+};
+
+static MemVector<CacheEntry, MEM_TEXTURES>::type cache;
+static size_t cache_bytes, cache_max;
+static std::mutex cache_mutex;
+
+static inline int block_bytes(int fmt)
+{
+	return fmt == BCFMT_BC1 ? 8 : 16;
+}
+
+size_t bc_size(int fmt, int xsz, int ysz)
+{
+	return (size_t)((xsz + 3) / 4) * ((ysz + 3) / 4) * block_bytes(fmt);
+}
+
+// gather a 4x4 block of RGBA pixels, clamping at the edges of the image
+static void load_block(const unsigned char *pixels, int xsz, int ysz, int bx, int by, unsigned char *block)
+{
+	for(int i=0; i<4; i++) {
+		int y = by * 4 + i;
+		if(y >= ysz) y = ysz - 1;
+		const unsigned char *row = pixels + y * xsz * 4;
+
+		for(int j=0; j<4; j++) {
+			int x = bx * 4 + j;
+			if(x >= xsz) x = xsz - 1;
+			memcpy(block, row + x * 4, 4);
+			block += 4;
+		}
+	}
+}
+
+// ---- BC1 color blocks ----
+
+static inline int quant565(const int *c)
+{
+	int r = (c[0] * 31 + 127) / 255;
+	int g = (c[1] * 63 + 127) / 255;
+	int b = (c[2] * 31 + 127) / 255;
+	return (r << 11) | (g << 5) | b;
+}
+
+static inline void expand565(int c, int *res)
+{
+	int r = (c >> 11) & 0x1f;
+	int g = (c >> 5) & 0x3f;
+	int b = c & 0x1f;
+	res[0] = (r << 3) | (r >> 2);
+	res[1] = (g << 2) | (g >> 4);
+	res[2] = (b << 3) | (b >> 2);
+}
+
+/* picks the nearest of the 4 palette colors for each pixel, 4 pixels at a
+ * time, and returns the total squared error. Ties go to the lower index, so
+ * that a block with equal endpoints only uses index 0.
+ */
+static int color_indices(const unsigned char *block, const int pal[4][3], unsigned int *indices)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rgb_mask = _mm_set1_epi32(0x00ffffff);
+
+	__m128i palw[4];
+	for(int i=0; i<4; i++) {
+		int c = pal[i][0] | (pal[i][1] << 8) | (pal[i][2] << 16);
+		palw[i] = _mm_unpacklo_epi8(_mm_set1_epi32(c), zero);
+	}
+
+	__m128i err_sum = zero;
+	unsigned int res = 0;
+
+	for(int i=0; i<4; i++) {
+		__m128i px = _mm_and_si128(_mm_loadu_si128((const __m128i*)(block + i * 16)), rgb_mask);
+		__m128i lo = _mm_unpacklo_epi8(px, zero);
+		__m128i hi = _mm_unpackhi_epi8(px, zero);
+
+		__m128i best = zero, best_idx = zero;
+		for(int j=0; j<4; j++) {
+			__m128i dlo = _mm_sub_epi16(lo, palw[j]);
+			__m128i dhi = _mm_sub_epi16(hi, palw[j]);
+			__m128 a = _mm_castsi128_ps(_mm_madd_epi16(dlo, dlo));
+			__m128 b = _mm_castsi128_ps(_mm_madd_epi16(dhi, dhi));
+			// add the (r^2 + g^2) and (b^2) halves of each pixel
+			__m128i dist = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))),
+					_mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+
+			if(j == 0) {
+				best = dist;
+			} else {
+				__m128i lt = _mm_cmplt_epi32(dist, best);
+				best = _mm_or_si128(_mm_and_si128(lt, dist), _mm_andnot_si128(lt, best));
+				best_idx = _mm_or_si128(_mm_and_si128(lt, _mm_set1_epi32(j)), _mm_andnot_si128(lt, best_idx));
+			}
+		}
+		err_sum = _mm_add_epi32(err_sum, best);
+
+		int idx[4];
+		_mm_storeu_si128((__m128i*)idx, best_idx);
+		for(int j=0; j<4; j++) {
+			res |= idx[j] << ((i * 4 + j) * 2);
+		}
+	}
+
+	int err[4];
+	_mm_storeu_si128((__m128i*)err, err_sum);
+	*indices = res;
+	return err[0] + err[1] + err[2] + err[3];
+}
+
+struct ColorBlock {
+	int c0, c1;		// 565 endpoints
+	unsigned int indices;
+	int err;
+};
+
+static void eval_endpoints(const unsigned char *block, const int *e0, const int *e1, ColorBlock *cb)
+{
+	cb->c0 = quant565(e0);
+	cb->c1 = quant565(e1);
+	if(cb->c0 < cb->c1) {
+		int tmp = cb->c0;
+		cb->c0 = cb->c1;
+		cb->c1 = tmp;
+	}
+
+	// with c0 > c1 the block is in 4 color mode (c0 == c1 only uses index 0)
+	int pal[4][3];
+	expand565(cb->c0, pal[0]);
+	expand565(cb->c1, pal[1]);
+	for(int i=0; i<3; i++) {
+		pal[2][i] = (2 * pal[0][i] + pal[1][i]) / 3;
+		pal[3][i] = (pal[0][i] + 2 * pal[1][i]) / 3;
+	}
+	cb->err = color_indices(block, pal, &cb->indices);
+}
+
+// bounding box endpoints, along the box diagonal which best matches the colors
+static void bbox_endpoints(const unsigned char *block, int *e0, int *e1)
+{
+	int mn[3] = {255, 255, 255}, mx[3] = {0, 0, 0};
+	for(int i=0; i<16; i++) {
+		for(int j=0; j<3; j++) {
+			int c = block[i * 4 + j];
+			if(c < mn[j]) mn[j] = c;
+			if(c > mx[j]) mx[j] = c;
+		}
+	}
+
+	int center[3];
+	for(int i=0; i<3; i++) {
+		// inset the box slightly, the endpoints are rarely hit exactly
+		int inset = (mx[i] - mn[i]) >> 4;
+		mn[i] += inset;
+		mx[i] -= inset;
+		center[i] = (mn[i] + mx[i]) / 2;
+	}
+
+	// flip green and blue if they're negatively correlated with red
+	int cov_rg = 0, cov_rb = 0;
+	for(int i=0; i<16; i++) {
+		int r = block[i * 4] - center[0];
+		cov_rg += r * (block[i * 4 + 1] - center[1]);
+		cov_rb += r * (block[i * 4 + 2] - center[2]);
+	}
+	for(int i=0; i<3; i++) {
+		e0[i] = mx[i];
+		e1[i] = mn[i];
+	}
+	if(cov_rg < 0) {
+		e0[1] = mn[1];
+		e1[1] = mx[1];
+	}
+	if(cov_rb < 0) {
+		e0[2] = mn[2];
+		e1[2] = mx[2];
+	}
+}
+
+// endpoints at the extents of the colors projected on their principal axis
+static void pca_endpoints(const unsigned char *block, int *e0, int *e1)
+{
+	float mean[3] = {0, 0, 0};
+	for(int i=0; i<16; i++) {
+		for(int j=0; j<3; j++) {
+			mean[j] += block[i * 4 + j];
+		}
+	}
+	for(int i=0; i<3; i++) {
+		mean[i] /= 16.0f;
+	}
+
+	float cov[6] = {0, 0, 0, 0, 0, 0};	// rr rg rb gg gb bb
+	for(int i=0; i<16; i++) {
+		float r = block[i * 4] - mean[0];
+		float g = block[i * 4 + 1] - mean[1];
+		float b = block[i * 4 + 2] - mean[2];
+		cov[0] += r * r;
+		cov[1] += r * g;
+		cov[2] += r * b;
+		cov[3] += g * g;
+		cov[4] += g * b;
+		cov[5] += b * b;
+	}
+
+	// power iteration, starting from the axis with the largest variance
+	float axis[3] = {1, 1, 1};
+	if(cov[0] >= cov[3] && cov[0] >= cov[5]) {
+		axis[1] = axis[2] = 0.5f;
+	} else if(cov[3] >= cov[5]) {
+		axis[0] = axis[2] = 0.5f;
+	} else {
+		axis[0] = axis[1] = 0.5f;
+	}
+	for(int i=0; i<8; i++) {
+		float x = axis[0] * cov[0] + axis[1] * cov[1] + axis[2] * cov[2];
+		float y = axis[0] * cov[1] + axis[1] * cov[3] + axis[2] * cov[4];
+		float z = axis[0] * cov[2] + axis[1] * cov[4] + axis[2] * cov[5];
+		float len = fabs(x) > fabs(y) ? fabs(x) : fabs(y);
+		if(fabs(z) > len) len = fabs(z);
+		if(len < 1e-6f) break;	// flat block, keep the initial axis
+		axis[0] = x / len;
+		axis[1] = y / len;
+		axis[2] = z / len;
+	}
+
+	float len_sq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float tmin = 0.0f, tmax = 0.0f;
+	for(int i=0; i<16; i++) {
+		float t = ((block[i * 4] - mean[0]) * axis[0] + (block[i * 4 + 1] - mean[1]) * axis[1] +
+				(block[i * 4 + 2] - mean[2]) * axis[2]) / len_sq;
+		if(t < tmin) tmin = t;
+		if(t > tmax) tmax = t;
+	}
+
+	for(int i=0; i<3; i++) {
+		int a = (int)(mean[i] + axis[i] * tmax + 0.5f);
+		int b = (int)(mean[i] + axis[i] * tmin + 0.5f);
+		e0[i] = a < 0 ? 0 : (a > 255 ? 255 : a);
+		e1[i] = b < 0 ? 0 : (b > 255 ? 255 : b);
+	}
+}
+
+/* least squares fit of the endpoints to the colors, given the current
+ * indices. Returns false if the system is singular (all pixels on one index).
+ */
+static bool refine_endpoints(const unsigned char *block, unsigned int indices, int *e0, int *e1)
+{
+	static const float weight0[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+	float aa = 0, ab = 0, bb = 0;
+	float ax[3] = {0, 0, 0}, bx[3] = {0, 0, 0};
+	for(int i=0; i<16; i++) {
+		float a = weight0[(indices >> (i * 2)) & 3];
+		float b = 1.0f - a;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for(int j=0; j<3; j++) {
+			ax[j] += a * block[i * 4 + j];
+			bx[j] += b * block[i * 4 + j];
+		}
+	}
+
+	float det = aa * bb - ab * ab;
+	if(fabs(det) < 1e-6f) {
+		return false;
+	}
+	float inv_det = 1.0f / det;
+
+	for(int i=0; i<3; i++) {
+		int c0 = (int)((ax[i] * bb - bx[i] * ab) * inv_det + 0.5f);
+		int c1 = (int)((bx[i] * aa - ax[i] * ab) * inv_det + 0.5f);
+		e0[i] = c0 < 0 ? 0 : (c0 > 255 ? 255 : c0);
+		e1[i] = c1 < 0 ? 0 : (c1 > 255 ? 255 : c1);
+	}
+	return true;
+}
+
+static void encode_bc1_block(const unsigned char *block, bool quality, unsigned char *dest)
+{
+	int e0[3], e1[3];
+	ColorBlock best;
+
+	bbox_endpoints(block, e0, e1);
+	eval_endpoints(block, e0, e1, &best);
+
+	if(quality && best.err > 0) {
+		ColorBlock cb;
+		pca_endpoints(block, e0, e1);
+		eval_endpoints(block, e0, e1, &cb);
+		if(cb.err < best.err) {
+			best = cb;
+		}
+
+		for(int i=0; i<2 && best.err > 0; i++) {
+			if(!refine_endpoints(block, best.indices, e0, e1)) {
+				break;
+			}
+			eval_endpoints(block, e0, e1, &cb);
+			if(cb.err >= best.err) {
+				break;
+			}
+			best = cb;
+		}
+	}
+
+	dest[0] = best.c0 & 0xff;
+	dest[1] = best.c0 >> 8;
+	dest[2] = best.c1 & 0xff;
+	dest[3] = best.c1 >> 8;
+	for(int i=0; i<4; i++) {
+		dest[4 + i] = (best.indices >> (i * 8)) & 0xff;
+	}
+}
+
+// ---- BC4 single channel blocks ----
+
+// nearest palette entry for all 16 values at once, returns the total squared error
+static int bc4_indices(__m128i vals, const int *pal, unsigned char *indices)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	__m128i best = _mm_set1_epi8((char)0xff), best_idx = zero;
+	for(int i=0; i<8; i++) {
+		__m128i p = _mm_set1_epi8((char)pal[i]);
+		__m128i d = _mm_or_si128(_mm_subs_epu8(vals, p), _mm_subs_epu8(p, vals));
+		// d < best (unsigned) where best - d doesn't saturate to zero
+		__m128i lt = _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(best, d), zero), _mm_set1_epi8((char)0xff));
+		if(i == 0) {
+			lt = _mm_set1_epi8((char)0xff);
+		}
+		best = _mm_or_si128(_mm_and_si128(lt, d), _mm_andnot_si128(lt, best));
+		best_idx = _mm_or_si128(_mm_and_si128(lt, _mm_set1_epi8((char)i)), _mm_andnot_si128(lt, best_idx));
+	}
+	_mm_storeu_si128((__m128i*)indices, best_idx);
+
+	__m128i lo = _mm_unpacklo_epi8(best, zero);
+	__m128i hi = _mm_unpackhi_epi8(best, zero);
+	__m128i sq = _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi));
+	int err[4];
+	_mm_storeu_si128((__m128i*)err, sq);
+	return err[0] + err[1] + err[2] + err[3];
+}
+
+static void bc4_palette(int a0, int a1, int *pal)
+{
+	pal[0] = a0;
+	pal[1] = a1;
+	if(a0 > a1) {
+		for(int i=1; i<7; i++) {
+			pal[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+		}
+	} else {
+		for(int i=1; i<5; i++) {
+			pal[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+		}
+		pal[6] = 0;
+		pal[7] = 255;
+	}
+}
+
+static int eval_bc4(__m128i vals, int a0, int a1, unsigned char *indices)
+{
+	int pal[8];
+	bc4_palette(a0, a1, pal);
+	return bc4_indices(vals, pal, indices);
+}
+
+static void encode_bc4_block(const unsigned char *vals, bool quality, unsigned char *dest)
+{
+	int mn = 255, mx = 0;
+	int mn6 = 255, mx6 = 0;	// excluding 0 and 255, which the 6 value mode has for free
+	for(int i=0; i<16; i++) {
+		int v = vals[i];
+		if(v < mn) mn = v;
+		if(v > mx) mx = v;
+		if(v > 0 && v < 255) {
+			if(v < mn6) mn6 = v;
+			if(v > mx6) mx6 = v;
+		}
+	}
+
+	__m128i v = _mm_loadu_si128((const __m128i*)vals);
+	unsigned char indices[16], tmp_indices[16];
+
+	// 8 value mode over the whole range
+	int a0 = mx, a1 = mn;
+	int err = eval_bc4(v, a0, a1, indices);
+
+	if(quality && err > 0) {
+		// try pulling the endpoints in a bit
+		for(int i=0; i<=3; i++) {
+			for(int j=0; j<=3; j++) {
+				if(i == 0 && j == 0) continue;
+				int t0 = mx - i, t1 = mn + j;
+				if(t0 <= t1) continue;
+
+				int e = eval_bc4(v, t0, t1, tmp_indices);
+				if(e < err) {
+					err = e;
+					a0 = t0;
+					a1 = t1;
+					memcpy(indices, tmp_indices, 16);
+				}
+			}
+		}
+
+		// 6 value mode, when the extremes are 0 or 255
+		if(mn6 <= mx6 && (mn == 0 || mx == 255)) {
+			int e = eval_bc4(v, mn6, mx6, tmp_indices);
+			if(e < err) {
+				err = e;
+				a0 = mn6;
+				a1 = mx6;
+				memcpy(indices, tmp_indices, 16);
+			}
+		}
+	}
+
+	dest[0] = a0;
+	dest[1] = a1;
+	unsigned long long bits = 0;
+	for(int i=0; i<16; i++) {
+		bits |= (unsigned long long)indices[i] << (i * 3);
+	}
+	for(int i=0; i<6; i++) {
+		dest[2 + i] = (bits >> (i * 8)) & 0xff;
+	}
+}
+
+// ---- images ----
+
+static void encode_rows(const BCJob *job, int start, int end)
+{
+	int bsize = block_bytes(job->fmt);
+	unsigned char block[64], chan[16];
+
+	for(int i=start; i<end; i++) {
+		unsigned char *dest = job->dest + (size_t)i * job->bw * bsize;
+
+		for(int j=0; j<job->bw; j++) {
+			load_block(job->pixels, job->xsz, job->ysz, j, i, block);
+
+			switch(job->fmt) {
+			case BCFMT_BC1:
+				encode_bc1_block(block, job->quality, dest);
+				break;
+
+			case BCFMT_BC3:
+				for(int k=0; k<16; k++) {
+					chan[k] = block[k * 4 + 3];
+				}
+				encode_bc4_block(chan, job->quality, dest);
+				encode_bc1_block(block, job->quality, dest + 8);
+				break;
+
+			case BCFMT_BC5:
+				for(int c=0; c<2; c++) {
+					for(int k=0; k<16; k++) {
+						chan[k] = block[k * 4 + c];
+					}
+					encode_bc4_block(chan, job->quality, dest + c * 8);
+				}
+				break;
+			}
+			dest += bsize;
+		}
+	}
+}
+
+static void encode_job(int job, void *cls)
+{
+	BCJob *bj = (BCJob*)cls;
+	int start = job * bj->rows_per_job;
+	int end = start + bj->rows_per_job;
+	if(end > bj->bh) end = bj->bh;
+	if(start < end) {
+		encode_rows(bj, start, end);
+	}
+}
+
+static unsigned long long hash_image(int xsz, int ysz, const unsigned char *pixels)
+{
+	const unsigned long long k1 = 0x9e3779b97f4a7c15ULL;
+	const unsigned long long k2 = 0xc2b2ae3d27d4eb4fULL;
+
+	size_t size = (size_t)xsz * ysz * 4;
+	unsigned long long h = size * k1;
+
+	size_t nwords = size / 8;
+	for(size_t i=0; i<nwords; i++) {
+		unsigned long long w;
+		memcpy(&w, pixels + i * 8, 8);
+		h ^= w * k2;
+		h = ((h << 31) | (h >> 33)) * k1;
+	}
+	for(size_t i=nwords * 8; i<size; i++) {
+		h = (h ^ pixels[i]) * k1;
+	}
+
+	h ^= h >> 33;
+	h *= k2;
+	h ^= h >> 29;
+	return h;
+}
+
+static bool cache_lookup(unsigned long long hash, int fmt, bool quality, int xsz, int ysz, unsigned char *dest)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+
+	for(size_t i=0; i<cache.size(); i++) {
+		const CacheEntry *ent = &cache[i];
+		if(ent->hash == hash && ent->fmt == fmt && ent->quality == quality && ent->xsz == xsz && ent->ysz == ysz) {
+			memcpy(dest, ent->data, ent->size);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void evict(size_t max_bytes)
+{
+	// oldest first
+	size_t count = 0;
+	while(count < cache.size() && cache_bytes > max_bytes) {
+		cache_bytes -= cache[count].size;
+		mem_free(cache[count].data);
+		count++;
+	}
+	cache.erase(cache.begin(), cache.begin() + count);
+}
+
+static void cache_store(unsigned long long hash, int fmt, bool quality, int xsz, int ysz,
+		const unsigned char *data, size_t size)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+
+	if(size > cache_max) {
+		return;
+	}
+	evict(cache_max - size);
+
+	CacheEntry ent;
+	ent.hash = hash;
+	ent.fmt = fmt;
+	ent.quality = quality;
+	ent.xsz = xsz;
+	ent.ysz = ysz;
+	ent.size = size;
+	ent.data = (unsigned char*)mem_alloc(size, MEM_TEXTURES);
+	memcpy(ent.data, data, size);
+
+	cache.push_back(ent);
+	cache_bytes += size;
+}
+
+void bc_encode(int fmt, bool quality, int xsz, int ysz, const unsigned char *pixels, unsigned char *dest)
+{
+	bool use_cache = cache_max > 0;
+	unsigned long long hash = 0;
+	if(use_cache) {
+		hash = hash_image(xsz, ysz, pixels);
+		if(cache_lookup(hash, fmt, quality, xsz, ysz, dest)) {
+			return;
+		}
+	}
+
+	BCJob bj;
+	bj.fmt = fmt;
+	bj.quality = quality;
+	bj.xsz = xsz;
+	bj.ysz = ysz;
+	bj.pixels = pixels;
+	bj.dest = dest;
+	bj.bw = (xsz + 3) / 4;
+	bj.bh = (ysz + 3) / 4;
+
+	if(bj.bw * bj.bh >= PAR_BC_THRES) {
+		ThreadPool *tpool = get_thread_pool();
+		int njobs = tpool->get_num_threads();
+		bj.rows_per_job = (bj.bh + njobs - 1) / njobs;
+		tpool->run(njobs, encode_job, &bj);
+	} else {
+		encode_rows(&bj, 0, bj.bh);
+	}
+
+	if(use_cache) {
+		cache_store(hash, fmt, quality, xsz, ysz, dest, bc_size(fmt, xsz, ysz));
+	}
+}
+
+void bc_set_cache_size(size_t max_bytes)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	cache_max = max_bytes;
+	evict(max_bytes);
+}
+
+void bc_clear_cache()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	evict(0);
+}
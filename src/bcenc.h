@@ -0,0 +1,45 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_BCENC_H_
+#define D3DUT_BCENC_H_
+
+#include <stddef.h>
+
+// block compression formats, must match D3DUT_BC* in d3dut.h
+enum {
+	BCFMT_BC1,		// RGB, 8 bytes per 4x4 block
+	BCFMT_BC3,		// RGBA, BC4 alpha block followed by a BC1 color block
+	BCFMT_BC5		// RG, two BC4 blocks
+};
+
+// size in bytes of an image compressed in format fmt
+size_t bc_size(int fmt, int xsz, int ysz);
+
+/* compresses an RGBA8 image into fmt blocks, bc_size(fmt, xsz, ysz) bytes.
+ * Partial blocks at the right and bottom edges repeat the last column/row.
+ * Large images are split in rows of blocks across threads. If the cache is
+ * enabled, the result is stored there, keyed by a hash of the source, and
+ * reused when the same image is compressed again.
+ */
+void bc_encode(int fmt, bool quality, int xsz, int ysz, const unsigned char *pixels, unsigned char *dest);
+
+// 0 disables the cache (the default)
+void bc_set_cache_size(size_t max_bytes);
+void bc_clear_cache();
+
+#endif	// D3DUT_BCENC_H_
@@ -0,0 +1,387 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include "d3dut.h"
+#include "capture.h"
+#include "imgenc.h"
+#include "logmsg.h"
+#include "alloc.h"
+
+/* Frames are copied into a ring of staging textures, which are mapped a few
+ * frames later when the GPU is (hopefully) done with them, so that the
+ * readback never stalls the pipeline. The pixels are then handed to a pool
+ * of encoder threads. If either the ring or the encoder queue is full, the
+ * frame is dropped instead of waiting.
+ */
+
+#define RING_SIZE		4
+#define MAP_LATENCY		2	// frames to wait before trying to map a copy
+#define MAX_QUEUED		8	// frames waiting to be encoded
+#define MAX_WORKERS		4
+
+struct CapFrame {
+	MemVector<unsigned char, MEM_CAPTURE>::type pixels;
+	int width, height;
+	int frame;
+};
+
+static bool active;
+static char *path_fmt;
+static int img_format;
+static int cap_win;
+
+static ID3D11Texture2D *staging[RING_SIZE];
+static int staging_frame[RING_SIZE];
+static int ring_head, ring_tail, ring_used;
+static ID3D11Texture2D *resolve_tex;
+static int cap_width, cap_height;
+
+static int frame_num;
+static std::atomic<int> num_written, num_dropped;
+
+static MemVector<std::thread, MEM_CAPTURE>::type workers;
+static std::mutex queue_mutex;
+static std::condition_variable queue_cond, free_cond;
+// fixed-size queues, so that steady-state capture never allocates
+static CapFrame *queue[MAX_QUEUED];
+static int queue_head, queue_len;
+static CapFrame *free_frames[MAX_QUEUED];
+static int num_free;
+static bool quit_workers;
+
+static bool create_targets(ID3D11Texture2D *backbuf);
+static void destroy_targets();
+static void retrieve(bool wait);
+static void worker_func();
+
+bool capture_start(const char *path, int format)
+{
+	if(active) {
+		capture_stop();
+	}
+
+	switch(format) {
+	case D3DUT_CAPTURE_PNG:
+	case D3DUT_CAPTURE_QOI:
+	case D3DUT_CAPTURE_RAW:
+		break;
+	default:
+		warning("capture_start: invalid image format: %d\n", format);
+		return false;
+	}
+
+	cap_win = get_active_win();
+	if(!get_window(cap_win)) {
+		warning("capture_start: no active window\n");
+		return false;
+	}
+
+	path_fmt = mem_strdup(path, MEM_CAPTURE);
+	img_format = format;
+	frame_num = 0;
+	num_written = 0;
+	num_dropped = 0;
+	ring_head = ring_tail = ring_used = 0;
+	cap_width = cap_height = 0;
+
+	for(int i=0; i<MAX_QUEUED; i++) {
+		free_frames[i] = mem_new<CapFrame>(MEM_CAPTURE);
+	}
+	num_free = MAX_QUEUED;
+	queue_head = queue_len = 0;
+
+	quit_workers = false;
+	int nworkers = std::thread::hardware_concurrency() - 1;
+	if(nworkers < 1) nworkers = 1;
+	if(nworkers > MAX_WORKERS) nworkers = MAX_WORKERS;
+	for(int i=0; i<nworkers; i++) {
+		workers.push_back(std::thread(worker_func));
+	}
+
+	active = true;
+	return true;
+}
+
+void capture_stop()
+{
+	if(!active) return;
+
+	// flush whatever is still in flight, waiting for it this time
+	retrieve(true);
+	destroy_targets();
+
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		quit_workers = true;
+	}
+	queue_cond.notify_all();
+	for(size_t i=0; i<workers.size(); i++) {
+		workers[i].join();
+	}
+	workers.clear();
+
+	for(int i=0; i<num_free; i++) {
+		mem_delete(free_frames[i]);
+	}
+	num_free = 0;
+
+	mem_free(path_fmt);
+	path_fmt = 0;
+	active = false;
+}
+
+void capture_abandon()
+{
+	if(!active) return;
+
+	destroy_targets();
+
+	// the queued frames and the free list are leaked, the workers might still refer to them
+	for(size_t i=0; i<workers.size(); i++) {
+		workers[i].detach();
+	}
+	workers.clear();
+	num_free = 0;
+	path_fmt = 0;
+	active = false;
+}
+
+bool capture_active()
+{
+	return active;
+}
+
+void capture_frame(Window *win)
+{
+	if(!active || get_window(cap_win) != win) {
+		return;
+	}
+
+	ID3D11Texture2D *backbuf;
+	if(win->swap->GetBuffer(0, __uuidof(ID3D11Texture2D), (void**)&backbuf) != 0) {
+		return;
+	}
+
+	D3D11_TEXTURE2D_DESC desc;
+	backbuf->GetDesc(&desc);
+	if((int)desc.Width != cap_width || (int)desc.Height != cap_height) {
+		// the window was resized, frames still in flight are lost
+		num_dropped += ring_used;
+		destroy_targets();
+		if(!create_targets(backbuf)) {
+			backbuf->Release();
+			capture_stop();
+			return;
+		}
+	}
+
+	retrieve(false);
+
+	if(ring_used >= RING_SIZE) {
+		num_dropped++;
+	} else {
+		if(resolve_tex) {
+			d3dut_ctx->ResolveSubresource(resolve_tex, 0, backbuf, 0, desc.Format);
+			d3dut_ctx->CopyResource(staging[ring_head], resolve_tex);
+		} else {
+			d3dut_ctx->CopyResource(staging[ring_head], backbuf);
+		}
+		staging_frame[ring_head] = frame_num;
+		ring_head = (ring_head + 1) % RING_SIZE;
+		ring_used++;
+	}
+	frame_num++;
+
+	backbuf->Release();
+}
+
+int capture_frames_written()
+{
+	return num_written;
+}
+
+int capture_frames_dropped()
+{
+	return num_dropped;
+}
+
+static bool create_targets(ID3D11Texture2D *backbuf)
+{
+	D3D11_TEXTURE2D_DESC desc;
+	backbuf->GetDesc(&desc);
+
+	if(desc.SampleDesc.Count > 1) {
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.BindFlags = 0;
+		desc.MiscFlags = 0;
+		if(d3dut_dev->CreateTexture2D(&desc, 0, &resolve_tex) != 0) {
+			warning("capture: failed to create resolve texture\n");
+			return false;
+		}
+	}
+
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	desc.MiscFlags = 0;
+
+	for(int i=0; i<RING_SIZE; i++) {
+		if(d3dut_dev->CreateTexture2D(&desc, 0, staging + i) != 0) {
+			warning("capture: failed to create staging texture\n");
+			destroy_targets();
+			return false;
+		}
+	}
+
+	cap_width = desc.Width;
+	cap_height = desc.Height;
+	ring_head = ring_tail = ring_used = 0;
+	return true;
+}
+
+static void destroy_targets()
+{
+	for(int i=0; i<RING_SIZE; i++) {
+		if(staging[i]) {
+			staging[i]->Release();
+			staging[i] = 0;
+		}
+	}
+	if(resolve_tex) {
+		resolve_tex->Release();
+		resolve_tex = 0;
+	}
+	ring_head = ring_tail = ring_used = 0;
+	cap_width = cap_height = 0;
+}
+
+// map the oldest copies which are ready, and queue them for encoding
+static void retrieve(bool wait)
+{
+	while(ring_used > 0) {
+		int idx = ring_tail;
+		if(!wait && frame_num - staging_frame[idx] < MAP_LATENCY) {
+			break;
+		}
+
+		D3D11_MAPPED_SUBRESOURCE map;
+		HRESULT res = d3dut_ctx->Map(staging[idx], 0, D3D11_MAP_READ, wait ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT, &map);
+		if(res == DXGI_ERROR_WAS_STILL_DRAWING) {
+			break;
+		}
+
+		if(res == 0) {
+			CapFrame *frm = 0;
+			{
+				std::unique_lock<std::mutex> lock(queue_mutex);
+				while(wait && !num_free) {
+					free_cond.wait(lock);
+				}
+				if(num_free) {
+					frm = free_frames[--num_free];
+				}
+			}
+
+			if(frm) {
+				int rowsz = cap_width * 4;
+				frm->width = cap_width;
+				frm->height = cap_height;
+				frm->frame = staging_frame[idx];
+				frm->pixels.resize(rowsz * cap_height);
+				for(int i=0; i<cap_height; i++) {
+					memcpy(&frm->pixels[i * rowsz], (char*)map.pData + i * map.RowPitch, rowsz);
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(queue_mutex);
+					queue[(queue_head + queue_len++) % MAX_QUEUED] = frm;
+				}
+				queue_cond.notify_one();
+			} else {
+				num_dropped++;	// the encoders can't keep up
+			}
+			d3dut_ctx->Unmap(staging[idx], 0);
+		} else {
+			num_dropped++;
+		}
+
+		ring_tail = (ring_tail + 1) % RING_SIZE;
+		ring_used--;
+	}
+}
+
+static void worker_func()
+{
+	ImgBuffer buf;
+	MemVector<char, MEM_CAPTURE>::type fname(strlen(path_fmt) + 32);
+
+	for(;;) {
+		CapFrame *frm;
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			while(!queue_len && !quit_workers) {
+				queue_cond.wait(lock);
+			}
+			if(!queue_len) {
+				return;	// quit only after everything queued is written out
+			}
+			frm = queue[queue_head];
+			queue_head = (queue_head + 1) % MAX_QUEUED;
+			queue_len--;
+		}
+
+		buf.clear();
+		switch(img_format) {
+		case D3DUT_CAPTURE_PNG:
+			encode_png(&frm->pixels[0], frm->width, frm->height, frm->width * 4, &buf);
+			break;
+		case D3DUT_CAPTURE_QOI:
+			encode_qoi(&frm->pixels[0], frm->width, frm->height, frm->width * 4, &buf);
+			break;
+		case D3DUT_CAPTURE_RAW:
+			encode_raw(&frm->pixels[0], frm->width, frm->height, frm->width * 4, &buf);
+			break;
+		}
+
+		_snprintf(&fname[0], fname.size(), path_fmt, frm->frame);
+		fname[fname.size() - 1] = 0;
+
+		FILE *fp = fopen(&fname[0], "wb");
+		if(fp && fwrite(&buf[0], 1, buf.size(), fp) == buf.size()) {
+			num_written++;
+		} else {
+			warning("capture: failed to write: %s\n", &fname[0]);
+			num_dropped++;
+		}
+		if(fp) fclose(fp);
+
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			free_frames[num_free++] = frm;
+		}
+		free_cond.notify_one();
+	}
+}
@@ -0,0 +1,38 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_CAPTURE_H_
+#define D3DUT_CAPTURE_H_
+
+#include "win.h"
+
+bool capture_start(const char *path, int format);
+/* capture_stop writes out the frames still in flight and joins the encoder
+ * threads. capture_abandon is for process exit, where the threads can't be
+ * waited for: it detaches them and drops whatever wasn't written yet.
+ */
+void capture_stop();
+void capture_abandon();
+bool capture_active();
+
+// called before presenting a frame of the window being captured
+void capture_frame(Window *win);
+
+int capture_frames_written();
+int capture_frames_dropped();
+
+#endif	// D3DUT_CAPTURE_H_
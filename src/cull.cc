@@ -0,0 +1,363 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <string.h>
+#include <mutex>
+#include <emmintrin.h>
+#include <immintrin.h>
+#include "cull.h"
+#include "thrpool.h"
+#include "simd.h"
+
+// scenes with at least this many objects are split across threads
+#define PAR_CULL_THRES	65536
+#define MAX_CULL_JOBS	64
+
+/* planes in the order they're tested, with precomputed per-plane pointers to
+ * the min or max coordinate arrays of the boxes: the corner furthest along
+ * the plane normal, which is outside only if the whole box is.
+ */
+struct CullPlanes {
+	float plane[6][4];
+	const float *corner[6][3];
+};
+
+struct CullJob;
+typedef int (*CullFunc)(const CullJob *cj, int start, int end, int *out);
+
+struct CullJob {
+	CullPlanes planes;
+	CullFunc func;
+	const D3DUT_Spheres *spheres;
+	const D3DUT_AABBs *boxes;
+	int count, chunk_size;
+	int *visible;
+	int num_visible[MAX_CULL_JOBS];
+};
+
+// for each 8 bit visibility mask: the positions of the set bits, and their number
+static unsigned char compact_lut[256][8];
+static unsigned char popcount_lut[256];
+static std::once_flag luts_once;
+
+static void init_luts()
+{
+	for(int i=0; i<256; i++) {
+		int n = 0;
+		for(int j=0; j<8; j++) {
+			if(i & (1 << j)) {
+				compact_lut[i][n++] = j;
+			}
+		}
+		popcount_lut[i] = n;
+	}
+}
+
+void frustum_from_matrix(const float *m, D3DUT_Frustum *frustum)
+{
+	/* m transforms column vectors, so the clip coordinates are the dot products
+	 * of its rows with the point, and the D3D clip volume -w <= x,y <= w,
+	 * 0 <= z <= w gives the planes as sums and differences of rows.
+	 */
+	const float *row[4] = {m, m + 4, m + 8, m + 12};
+
+	for(int i=0; i<4; i++) {
+		frustum->plane[0][i] = row[3][i] + row[0][i];	// left
+		frustum->plane[1][i] = row[3][i] - row[0][i];	// right
+		frustum->plane[2][i] = row[3][i] + row[1][i];	// bottom
+		frustum->plane[3][i] = row[3][i] - row[1][i];	// top
+		frustum->plane[4][i] = row[2][i];				// near
+		frustum->plane[5][i] = row[3][i] - row[2][i];	// far
+	}
+
+	for(int i=0; i<6; i++) {
+		float *p = frustum->plane[i];
+		float len = sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		if(len > 0.0f) {
+			float s = 1.0f / len;
+			p[0] *= s;
+			p[1] *= s;
+			p[2] *= s;
+			p[3] *= s;
+		}
+	}
+}
+
+// ---- spheres ----
+
+static inline bool sphere_visible(const CullJob *cj, int i)
+{
+	const D3DUT_Spheres *s = cj->spheres;
+	for(int j=0; j<6; j++) {
+		const float *p = cj->planes.plane[j];
+		if(p[0] * s->x[i] + p[1] * s->y[i] + p[2] * s->z[i] + p[3] < -s->radius[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static int cull_spheres_sse(const CullJob *cj, int start, int end, int *out)
+{
+	const D3DUT_Spheres *s = cj->spheres;
+	const __m128 zero = _mm_setzero_ps();
+	int n = 0;
+
+	int i = start;
+	for(; i + 4 <= end; i += 4) {
+		__m128 x = _mm_loadu_ps(s->x + i);
+		__m128 y = _mm_loadu_ps(s->y + i);
+		__m128 z = _mm_loadu_ps(s->z + i);
+		__m128 neg_rad = _mm_sub_ps(zero, _mm_loadu_ps(s->radius + i));
+
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for(int j=0; j<6; j++) {
+			const float *p = cj->planes.plane[j];
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[0]), x), _mm_mul_ps(_mm_set1_ps(p[1]), y)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[2]), z), _mm_set1_ps(p[3])));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, neg_rad));
+		}
+
+		// branchless compaction, out[n] is always at or before out[i - start]
+		int mask = _mm_movemask_ps(inside);
+		for(int j=0; j<4; j++) {
+			out[n] = i + j;
+			n += (mask >> j) & 1;
+		}
+	}
+
+	for(; i<end; i++) {
+		if(sphere_visible(cj, i)) {
+			out[n++] = i;
+		}
+	}
+	return n;
+}
+
+TARGET_AVX2 static int cull_spheres_avx2(const CullJob *cj, int start, int end, int *out)
+{
+	const D3DUT_Spheres *s = cj->spheres;
+	const __m256 zero = _mm256_setzero_ps();
+	int n = 0;
+
+	__m256 plane[6][4];
+	for(int j=0; j<6; j++) {
+		for(int k=0; k<4; k++) {
+			plane[j][k] = _mm256_set1_ps(cj->planes.plane[j][k]);
+		}
+	}
+
+	int i = start;
+	for(; i + 8 <= end; i += 8) {
+		__m256 x = _mm256_loadu_ps(s->x + i);
+		__m256 y = _mm256_loadu_ps(s->y + i);
+		__m256 z = _mm256_loadu_ps(s->z + i);
+		__m256 neg_rad = _mm256_sub_ps(zero, _mm256_loadu_ps(s->radius + i));
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for(int j=0; j<6; j++) {
+			__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane[j][0], x), _mm256_mul_ps(plane[j][1], y)),
+					_mm256_add_ps(_mm256_mul_ps(plane[j][2], z), plane[j][3]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, neg_rad, _CMP_GE_OQ));
+		}
+
+		/* store all 8 lanes of the compacted indices; the ones past the visible
+		 * count are overwritten by the next group, and never reach past out[i + 7]
+		 */
+		int mask = _mm256_movemask_ps(inside);
+		__m256i offs = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)compact_lut[mask]));
+		_mm256_storeu_si256((__m256i*)(out + n), _mm256_add_epi32(_mm256_set1_epi32(i), offs));
+		n += popcount_lut[mask];
+	}
+	_mm256_zeroupper();
+
+	for(; i<end; i++) {
+		if(sphere_visible(cj, i)) {
+			out[n++] = i;
+		}
+	}
+	return n;
+}
+
+// ---- axis aligned boxes ----
+
+static inline bool aabb_visible(const CullJob *cj, int i)
+{
+	for(int j=0; j<6; j++) {
+		const float *p = cj->planes.plane[j];
+		const float *const *c = cj->planes.corner[j];
+		if(p[0] * c[0][i] + p[1] * c[1][i] + p[2] * c[2][i] + p[3] < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static int cull_aabbs_sse(const CullJob *cj, int start, int end, int *out)
+{
+	const __m128 zero = _mm_setzero_ps();
+	int n = 0;
+
+	int i = start;
+	for(; i + 4 <= end; i += 4) {
+		__m128 inside = _mm_cmpeq_ps(zero, zero);
+		for(int j=0; j<6; j++) {
+			const float *p = cj->planes.plane[j];
+			const float *const *c = cj->planes.corner[j];
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[0]), _mm_loadu_ps(c[0] + i)),
+						_mm_mul_ps(_mm_set1_ps(p[1]), _mm_loadu_ps(c[1] + i))),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p[2]), _mm_loadu_ps(c[2] + i)), _mm_set1_ps(p[3])));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, zero));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		for(int j=0; j<4; j++) {
+			out[n] = i + j;
+			n += (mask >> j) & 1;
+		}
+	}
+
+	for(; i<end; i++) {
+		if(aabb_visible(cj, i)) {
+			out[n++] = i;
+		}
+	}
+	return n;
+}
+
+TARGET_AVX2 static int cull_aabbs_avx2(const CullJob *cj, int start, int end, int *out)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	int n = 0;
+
+	__m256 plane[6][4];
+	for(int j=0; j<6; j++) {
+		for(int k=0; k<4; k++) {
+			plane[j][k] = _mm256_set1_ps(cj->planes.plane[j][k]);
+		}
+	}
+
+	int i = start;
+	for(; i + 8 <= end; i += 8) {
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for(int j=0; j<6; j++) {
+			const float *const *c = cj->planes.corner[j];
+			__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane[j][0], _mm256_loadu_ps(c[0] + i)),
+						_mm256_mul_ps(plane[j][1], _mm256_loadu_ps(c[1] + i))),
+					_mm256_add_ps(_mm256_mul_ps(plane[j][2], _mm256_loadu_ps(c[2] + i)), plane[j][3]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, zero, _CMP_GE_OQ));
+		}
+
+		int mask = _mm256_movemask_ps(inside);
+		__m256i offs = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)compact_lut[mask]));
+		_mm256_storeu_si256((__m256i*)(out + n), _mm256_add_epi32(_mm256_set1_epi32(i), offs));
+		n += popcount_lut[mask];
+	}
+	_mm256_zeroupper();
+
+	for(; i<end; i++) {
+		if(aabb_visible(cj, i)) {
+			out[n++] = i;
+		}
+	}
+	return n;
+}
+
+// ---- jobs ----
+
+static void cull_job(int job, void *cls)
+{
+	CullJob *cj = (CullJob*)cls;
+	int start = job * cj->chunk_size;
+	int end = start + cj->chunk_size;
+	if(end > cj->count) end = cj->count;
+
+	// each job compacts into its own range of the output
+	cj->num_visible[job] = start < end ? cj->func(cj, start, end, cj->visible + start) : 0;
+}
+
+static int run_cull(CullJob *cj, CullFunc func)
+{
+	ThreadPool *tpool = 0;
+	int njobs = 1;
+	if(cj->count >= PAR_CULL_THRES) {
+		tpool = get_thread_pool();
+		njobs = tpool->get_num_threads();
+		if(njobs > MAX_CULL_JOBS) njobs = MAX_CULL_JOBS;
+	}
+	// keep the chunks a multiple of the SIMD width
+	cj->chunk_size = ((cj->count + njobs - 1) / njobs + 7) & ~7;
+
+	cj->func = func;
+	if(njobs > 1) {
+		tpool->run(njobs, cull_job, cj);
+	} else {
+		cull_job(0, cj);
+	}
+
+	// join the per-job ranges, moving each one down after the previous
+	int total = cj->num_visible[0];
+	for(int i=1; i<njobs; i++) {
+		int start = i * cj->chunk_size;
+		if(start >= cj->count) break;
+		memmove(cj->visible + total, cj->visible + start, cj->num_visible[i] * sizeof *cj->visible);
+		total += cj->num_visible[i];
+	}
+	return total;
+}
+
+static void init_job(CullJob *cj, const D3DUT_Frustum *frustum, int count, int *visible)
+{
+	// the cull functions may be called from several threads at once
+	std::call_once(luts_once, init_luts);
+	memcpy(cj->planes.plane, frustum->plane, sizeof cj->planes.plane);
+	cj->spheres = 0;
+	cj->boxes = 0;
+	cj->count = count;
+	cj->visible = visible;
+}
+
+int cull_spheres(const D3DUT_Frustum *frustum, const D3DUT_Spheres *spheres, int count, int *visible)
+{
+	if(count <= 0) return 0;
+
+	CullJob cj;
+	init_job(&cj, frustum, count, visible);
+	cj.spheres = spheres;
+
+	return run_cull(&cj, cpu_has_avx2() ? cull_spheres_avx2 : cull_spheres_sse);
+}
+
+int cull_aabbs(const D3DUT_Frustum *frustum, const D3DUT_AABBs *boxes, int count, int *visible)
+{
+	if(count <= 0) return 0;
+
+	CullJob cj;
+	init_job(&cj, frustum, count, visible);
+	cj.boxes = boxes;
+
+	const float *mins[] = {boxes->min_x, boxes->min_y, boxes->min_z};
+	const float *maxs[] = {boxes->max_x, boxes->max_y, boxes->max_z};
+	for(int i=0; i<6; i++) {
+		for(int j=0; j<3; j++) {
+			cj.planes.corner[i][j] = cj.planes.plane[i][j] >= 0.0f ? maxs[j] : mins[j];
+		}
+	}
+
+	return run_cull(&cj, cpu_has_avx2() ? cull_aabbs_avx2 : cull_aabbs_sse);
+}
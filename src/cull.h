@@ -0,0 +1,32 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_CULL_H_
+#define D3DUT_CULL_H_
+
+#include "d3dut.h"
+
+void frustum_from_matrix(const float *m, D3DUT_Frustum *frustum);
+
+/* write the indices of the volumes which are not entirely outside any of the
+ * frustum planes to visible, in increasing order, and return their number.
+ * visible must have room for count indices.
+ */
+int cull_spheres(const D3DUT_Frustum *frustum, const D3DUT_Spheres *spheres, int count, int *visible);
+int cull_aabbs(const D3DUT_Frustum *frustum, const D3DUT_AABBs *boxes, int count, int *visible);
+
+#endif	// D3DUT_CULL_H_
@@ -17,10 +17,25 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <vector>
 #include "d3dut.h"
 #include "win.h"
 #include "logmsg.h"
+#include "statecache.h"
+#include "rqueue.h"
+#include "thrpool.h"
+#include "geom.h"
+#include "meshopt.h"
+#include "mesh.h"
+#include "mipmap.h"
+#include "capture.h"
+#include "timestats.h"
+#include "latency.h"
+#include "alloc.h"
+#include "texture.h"
+#include "bcenc.h"
+#include "cull.h"
 
 static void d3dut_cleanup();
 
@@ -33,9 +48,53 @@ static int init_ysz = 480;
 static int init_dmflags = 0;
 
 static long init_time = -1;
+static bool software_driver;
 
 static D3DUT_IdleFunc idle_func;
 
+// fixed timestep updates, durations in nanoseconds
+static D3DUT_UpdateFunc update_func;
+static long long update_step = 10000000;
+static int update_max_steps = 5;
+static long long update_accum;
+static long long last_update = -1;
+static double update_alpha;
+static unsigned long update_steps, update_steps_dropped;
+
+// how long the loop may wait for events before calling the hook again, -1 for no limit
+static int loop_hook_wait = -1;
+// set by d3dut_main_loop_wake; never closed, other threads may still signal it at exit
+static HANDLE wake_event;
+
+static StateCache state_cache;
+static bool use_state_cache;
+
+static RenderQueue rqueue;
+
+static TimeHistogram frame_hist, display_hist, event_hist;
+
+static_assert(D3DUT_NUM_MEM_CATEGORIES == NUM_MEM_CATEGORIES, "memory categories mismatch");
+static_assert(sizeof(D3DUT_MemStats) == sizeof(MemStats), "memory stats structure mismatch");
+static_assert(D3DUT_NUM_INPUT_TYPES == NUM_INPUT_TYPES, "input event types mismatch");
+static_assert(D3DUT_MIP_BOX == MIP_BOX && D3DUT_MIP_TRIANGLE == MIP_TRIANGLE && D3DUT_MIP_KAISER == MIP_KAISER,
+		"mipmap filters mismatch");
+static_assert(D3DUT_BC1 == BCFMT_BC1 && D3DUT_BC3 == BCFMT_BC3 && D3DUT_BC5 == BCFMT_BC5,
+		"block compression formats mismatch");
+
+int D3DUTAPI d3dut_set_allocator(D3DUT_AllocFunc alloc, D3DUT_FreeFunc free, void *cls)
+{
+	if(!mem_set_allocator(alloc, free, cls)) {
+		warning("d3dut_set_allocator: too many allocator changes\n");
+		return -1;
+	}
+	return 0;
+}
+
+void D3DUTAPI d3dut_get_mem_stats(int category, D3DUT_MemStats *stats)
+{
+	mem_get_stats(category, (MemStats*)stats);
+}
+
 void D3DUTAPI d3dut_init(int *argc, char **argv)
 {
 	if(init_time >= 0) {
@@ -54,23 +113,75 @@ void D3DUTAPI d3dut_init(int *argc, char **argv)
 	wclass.hbrBackground = (HBRUSH)GetStockObject(BLACK_BRUSH);
 	RegisterClass(&wclass);
 
-	// create D3D device
+	/* create D3D device. If there's no hardware device available, fall back
+	 * to the WARP software rasterizer. The D3DUT_DRIVER environment variable
+	 * can be set to "hw" or "warp" to use only one of them.
+	 */
 	D3D_FEATURE_LEVEL feature_level[] = {
 		D3D_FEATURE_LEVEL_11_0,
 		D3D_FEATURE_LEVEL_10_1,
 		D3D_FEATURE_LEVEL_10_0
 	};
-	if(D3D11CreateDevice(0, D3D_DRIVER_TYPE_HARDWARE, 0, 0, feature_level, 3, D3D11_SDK_VERSION,
+	bool try_hw = true, try_warp = true;
+	const char *drvenv = getenv("D3DUT_DRIVER");
+	if(drvenv) {
+		if(strcmp(drvenv, "hw") == 0) {
+			try_warp = false;
+		} else if(strcmp(drvenv, "warp") == 0) {
+			try_hw = false;
+		} else {
+			warning("ignoring invalid D3DUT_DRIVER value: %s\n", drvenv);
+		}
+	}
+
+	d3dut_dev = 0;
+	if(try_hw && D3D11CreateDevice(0, D3D_DRIVER_TYPE_HARDWARE, 0, 0, feature_level, 3, D3D11_SDK_VERSION,
 			&d3dut_dev, 0, &d3dut_ctx) != 0) {
+		if(try_warp) {
+			warning("failed to create hardware D3D11 device, falling back to WARP\n");
+		}
+		d3dut_dev = 0;
+	}
+	if(!d3dut_dev && try_warp) {
+		if(D3D11CreateDevice(0, D3D_DRIVER_TYPE_WARP, 0, 0, feature_level, 3, D3D11_SDK_VERSION,
+				&d3dut_dev, 0, &d3dut_ctx) != 0) {
+			d3dut_dev = 0;
+		} else {
+			software_driver = true;
+		}
+	}
+	if(!d3dut_dev) {
 		fatal_error("failed to create D3D11 device\n");
 	}
+	state_cache.set_context(d3dut_ctx);
 	atexit(d3dut_cleanup);
 
+	if(!wake_event) {
+		wake_event = CreateEvent(0, FALSE, FALSE, 0);
+	}
+
+	init_timer();
+	frame_hist.set_budget(16666667);
+
 	init_time = timeGetTime();
 }
 
+/* stops everything that owns threads, while it's still safe to join them:
+ * called when d3dut_main_loop returns, rather than from the atexit handler
+ */
+static void shutdown_threads()
+{
+	capture_stop();
+	destroy_thread_pool();
+}
+
+/* atexit handler. If exit was called with the main loop still running,
+ * shutdown_threads didn't run, and nothing here may wait for a thread.
+ */
 static void d3dut_cleanup()
 {
+	capture_abandon();
+
 	for(size_t i=0; i<windows.size(); i++) {
 		if(windows[i]) {
 			destroy_window(i);
@@ -78,6 +189,11 @@ static void d3dut_cleanup()
 	}
 	windows.clear();
 
+	destroy_shapes();
+	bc_clear_cache();
+	state_cache.set_context(0);
+	detach_thread_pool();
+
 	if(d3dut_dev) {
 		d3dut_dev->Release();
 		d3dut_dev = 0;
@@ -90,6 +206,7 @@ static void d3dut_cleanup()
 
 	UnregisterClass(WINCLASSNAME, GetModuleHandle(0));
 	init_time = -1;
+	software_driver = false;
 }
 
 void D3DUTAPI d3dut_init_display_mode(unsigned int dmflags)
@@ -124,6 +241,12 @@ int D3DUTAPI d3dut_get_window()
 	return get_active_win();
 }
 
+HWND D3DUTAPI d3dut_get_window_handle(int win)
+{
+	Window *w = get_window(win);
+	return w ? w->win : 0;
+}
+
 void D3DUTAPI d3dut_display_func(D3DUT_DisplayFunc func)
 {
 	Window *win = get_window();
@@ -135,6 +258,33 @@ void D3DUTAPI d3dut_idle_func(D3DUT_IdleFunc func)
 	idle_func = func;
 }
 
+void D3DUTAPI d3dut_update_func(D3DUT_UpdateFunc func)
+{
+	if(!update_func || !func) {
+		// start accumulating from scratch, don't catch up on the time spent without updates
+		update_accum = 0;
+		last_update = -1;
+		update_alpha = 0.0;
+	}
+	update_func = func;
+}
+
+void D3DUTAPI d3dut_fixed_timestep(double dt, int max_steps)
+{
+	if(dt <= 0.0) {
+		warning("d3dut_fixed_timestep: invalid timestep: %g\n", dt);
+		return;
+	}
+	update_step = (long long)(dt * 1000000000.0);
+	if(update_step < 1) update_step = 1;
+	update_max_steps = max_steps > 0 ? max_steps : 1;
+}
+
+double D3DUTAPI d3dut_update_alpha()
+{
+	return update_alpha;
+}
+
 void D3DUTAPI d3dut_reshape_func(D3DUT_ReshapeFunc func)
 {
 	Window *win = get_window();
@@ -193,17 +343,87 @@ void D3DUTAPI d3dut_post_redisplay()
 void D3DUTAPI d3dut_swap_buffers()
 {
 	Window *win = get_window();
+	capture_frame(win);
 	win->swap->Present(0, 0);
+	win->latency->present();
+}
+
+void D3DUTAPI d3dut_main_loop_hook(D3DUT_LoopHookFunc func, void *cls)
+{
+	loop_hook = func;
+	loop_hook_cls = cls;
+	// give it a chance to run before blocking for events
+	loop_hook_wait = func ? 0 : -1;
+}
+
+void D3DUTAPI d3dut_main_loop_wake()
+{
+	if(wake_event) {
+		SetEvent(wake_event);
+	}
+}
+
+// milliseconds until the next fixed update step is due, rounded up
+static DWORD update_wait_msec()
+{
+	if(last_update < 0) return 0;
+
+	long long pending = update_accum + (long long)ticks_to_nsec(get_timer_ticks() - last_update);
+	if(pending >= update_step) return 0;
+	return (DWORD)((update_step - pending + 999999) / 1000000);
+}
+
+static void run_updates()
+{
+	long long now = get_timer_ticks();
+	if(last_update < 0) {
+		last_update = now;
+		return;
+	}
+	update_accum += (long long)ticks_to_nsec(now - last_update);
+	last_update = now;
+
+	int nsteps = 0;
+	while(update_func && update_accum >= update_step) {
+		if(nsteps >= update_max_steps) {
+			/* the updates can't keep up (or we were stalled), drop the backlog
+			 * instead of taking ever more steps per frame, which would make
+			 * every subsequent frame slower still.
+			 */
+			update_steps_dropped += (unsigned long)(update_accum / update_step);
+			update_accum %= update_step;
+			break;
+		}
+		update_func((double)update_step / 1000000000.0);
+		update_accum -= update_step;
+		update_steps++;
+		nsteps++;
+	}
+	update_alpha = (double)update_accum / (double)update_step;
+}
+
+/* stamps the message with its arrival time as it comes off the queue, so the
+ * input latency doesn't depend on the coarse message time stamps
+ */
+static void dispatch_message(MSG *msg)
+{
+	set_input_arrival(message_arrival_time(msg->time));
+	TranslateMessage(msg);
+	DispatchMessage(msg);
+	set_input_arrival(-1);
 }
 
 void D3DUTAPI d3dut_main_loop()
 {
 	MSG msg;
+	long long last_frame = -1;
 
 	for(;;) {
 		bool must_redisplay = false;
 		for(size_t i=0; i<windows.size(); i++) {
 			Window *win = windows[i];
+			if(!win) continue;
+
 			if(win->changed_size && win->reshape_func) {
 				win->changed_size = false;
 				set_active_win(i);
@@ -214,38 +434,125 @@ void D3DUTAPI d3dut_main_loop()
 			}
 		}
 
-		if(idle_func || must_redisplay) {
-			while(PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
-				TranslateMessage(&msg);
-				DispatchMessage(&msg);
-				if(msg.message == WM_QUIT) {
-					return;
-				}
+		if(!idle_func && loop_hook_wait != 0 && !must_redisplay) {
+			/* nothing to do right away: sleep until a message arrives, the next
+			 * fixed update step is due, the hook's deadline passes, or the hook
+			 * is woken up from another thread
+			 */
+			DWORD wait = INFINITE;
+			if(update_func) {
+				wait = update_wait_msec();
 			}
-
-			if(idle_func) { // checking again because a handler might have set this to 0
-				idle_func();
+			if(loop_hook_wait > 0 && (DWORD)loop_hook_wait < wait) {
+				wait = loop_hook_wait;
 			}
-		} else {
-			if(!GetMessage(&msg, 0, 0, 0)) {
+			if(wait > 0) {
+				MsgWaitForMultipleObjectsEx(1, &wake_event, wait, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+			}
+		}
+
+		long long events_start = get_timer_ticks();
+		int num_msg = 0;
+		while(PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
+			dispatch_message(&msg);
+			if(msg.message == WM_QUIT) {
+				shutdown_threads();
 				return;
 			}
-			TranslateMessage(&msg);
-			DispatchMessage(&msg);
+			num_msg++;
+		}
+		// empty polls would swamp the histogram with near-zero samples
+		if(num_msg) {
+			event_hist.record(ticks_to_nsec(get_timer_ticks() - events_start));
+		}
+
+		if(update_func) {
+			run_updates();
+		}
+		if(idle_func) { // checking again because a handler might have set this to 0
+			idle_func();
 		}
 
+		if(loop_hook) {
+			loop_hook_wait = loop_hook(D3DUT_HOOK_FRAME, 0, loop_hook_cls);
+		}
+
+		long long frame_start = -1;
 		for(size_t i=0; i<windows.size(); i++) {
 			Window *win = windows[i];
-			if(win->must_redisplay && win->display_func) {
+			if(win && win->must_redisplay && win->display_func) {
+				long long t0 = get_timer_ticks();
+				if(frame_start < 0) {
+					frame_start = t0;
+				}
+
 				win->must_redisplay = false;
 				set_active_win(i);
+				win->latency->begin_frame();
 				win->display_func();
 				ValidateRect(win->win, 0);
+
+				display_hist.record(ticks_to_nsec(get_timer_ticks() - t0));
+			}
+		}
+
+		if(frame_start >= 0) {
+			if(last_frame >= 0) {
+				frame_hist.record(ticks_to_nsec(frame_start - last_frame));
 			}
+			last_frame = frame_start;
+		}
+	}
+}
+
+
+void D3DUTAPI d3dut_get_frame_stats(D3DUT_FrameStats *stats)
+{
+	frame_hist.get_stats(&stats->frame);
+	display_hist.get_stats(&stats->display);
+	event_hist.get_stats(&stats->events);
+	stats->frames_over_budget = frame_hist.get_over_budget();
+}
+
+void D3DUTAPI d3dut_reset_frame_stats()
+{
+	frame_hist.reset();
+	display_hist.reset();
+	event_hist.reset();
+
+	for(size_t i=0; i<windows.size(); i++) {
+		if(windows[i]) {
+			windows[i]->latency->reset();
 		}
 	}
 }
 
+void D3DUTAPI d3dut_get_input_latency(int win, int type, D3DUT_TimeStats *stats)
+{
+	Window *w = get_window(win);
+	if(!w || type < 0 || type >= NUM_INPUT_TYPES) {
+		warning("d3dut_get_input_latency: invalid window (%d) or event type (%d)\n", win, type);
+		memset(stats, 0, sizeof *stats);
+		return;
+	}
+	w->latency->get_stats(type, stats);
+}
+
+void D3DUTAPI d3dut_frame_budget(double msec)
+{
+	frame_hist.set_budget((unsigned long long)(msec * 1000000.0));
+}
+
+int D3DUTAPI d3dut_capture_start(const char *path, int format)
+{
+	return capture_start(path, format) ? 0 : -1;
+}
+
+void D3DUTAPI d3dut_capture_stop()
+{
+	capture_stop();
+}
+
 
 int D3DUTAPI d3dut_get(unsigned int what)
 {
@@ -260,6 +567,61 @@ int D3DUTAPI d3dut_get(unsigned int what)
 	case D3DUT_ELAPSED_TIME:
 		return (long)timeGetTime() - init_time;
 
+	case D3DUT_SOFTWARE_DRIVER:
+		return software_driver ? 1 : 0;
+
+	case D3DUT_FRAME_TIME_MEAN:
+	case D3DUT_FRAME_TIME_P50:
+	case D3DUT_FRAME_TIME_P99:
+	case D3DUT_FRAME_TIME_MAX:
+	case D3DUT_DISPLAY_TIME_MEAN:
+	case D3DUT_DISPLAY_TIME_P50:
+	case D3DUT_DISPLAY_TIME_P99:
+	case D3DUT_DISPLAY_TIME_MAX:
+	case D3DUT_EVENT_TIME_MEAN:
+	case D3DUT_EVENT_TIME_P50:
+	case D3DUT_EVENT_TIME_P99:
+	case D3DUT_EVENT_TIME_MAX:
+		{
+			static const TimeHistogram *hist[] = {&frame_hist, &display_hist, &event_hist};
+			int idx = what - D3DUT_FRAME_TIME_MEAN;
+
+			D3DUT_TimeStats st;
+			hist[idx / 4]->get_stats(&st);
+			double val[] = {st.mean, st.p50, st.p99, st.max};
+			return (int)(val[idx % 4] * 1000.0);
+		}
+	case D3DUT_FRAMES_OVER_BUDGET:
+		return (int)frame_hist.get_over_budget();
+
+	case D3DUT_UPDATE_STEPS:
+		return (int)update_steps;
+	case D3DUT_UPDATE_STEPS_DROPPED:
+		return (int)update_steps_dropped;
+
+	case D3DUT_MEM_ALLOC_COUNT:
+		return (int)mem_total_allocs();
+
+	case D3DUT_STATE_CALLS_ISSUED:
+		return (int)state_cache.get_issued();
+	case D3DUT_STATE_CALLS_SKIPPED:
+		return (int)state_cache.get_skipped();
+
+	case D3DUT_RQ_PACKETS:
+		return rqueue.get_stats().num_packets;
+	case D3DUT_RQ_STATE_CHANGES:
+		return rqueue.get_stats().state_changes;
+	case D3DUT_RQ_STATE_CHANGES_SAVED:
+		{
+			const RQStats &st = rqueue.get_stats();
+			return st.state_changes_unsorted - st.state_changes;
+		}
+
+	case D3DUT_CAPTURE_FRAMES:
+		return capture_frames_written();
+	case D3DUT_CAPTURE_DROPPED:
+		return capture_frames_dropped();
+
 	default:
 		break;
 	}
@@ -267,6 +629,195 @@ int D3DUTAPI d3dut_get(unsigned int what)
 }
 
 
+void D3DUTAPI d3dut_state_cache(int enable)
+{
+	use_state_cache = enable != 0;
+	state_cache.invalidate();
+}
+
+void D3DUTAPI d3dut_invalidate_state_cache()
+{
+	state_cache.invalidate();
+}
+
+void D3DUTAPI d3dut_set_vertex_buffers(unsigned int start, unsigned int count, ID3D11Buffer *const *bufs,
+		const unsigned int *strides, const unsigned int *offsets)
+{
+	if(use_state_cache) {
+		state_cache.set_vertex_buffers(start, count, bufs, strides, offsets);
+	} else {
+		d3dut_ctx->IASetVertexBuffers(start, count, bufs, strides, offsets);
+	}
+}
+
+void D3DUTAPI d3dut_set_input_layout(ID3D11InputLayout *layout)
+{
+	if(use_state_cache) {
+		state_cache.set_input_layout(layout);
+	} else {
+		d3dut_ctx->IASetInputLayout(layout);
+	}
+}
+
+void D3DUTAPI d3dut_set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY top)
+{
+	if(use_state_cache) {
+		state_cache.set_primitive_topology(top);
+	} else {
+		d3dut_ctx->IASetPrimitiveTopology(top);
+	}
+}
+
+void D3DUTAPI d3dut_set_vertex_shader(ID3D11VertexShader *sdr)
+{
+	if(use_state_cache) {
+		state_cache.set_vertex_shader(sdr);
+	} else {
+		d3dut_ctx->VSSetShader(sdr, 0, 0);
+	}
+}
+
+void D3DUTAPI d3dut_set_pixel_shader(ID3D11PixelShader *sdr)
+{
+	if(use_state_cache) {
+		state_cache.set_pixel_shader(sdr);
+	} else {
+		d3dut_ctx->PSSetShader(sdr, 0, 0);
+	}
+}
+
+void D3DUTAPI d3dut_set_vs_constant_buffers(unsigned int start, unsigned int count, ID3D11Buffer *const *bufs)
+{
+	if(use_state_cache) {
+		state_cache.set_vs_constant_buffers(start, count, bufs);
+	} else {
+		d3dut_ctx->VSSetConstantBuffers(start, count, bufs);
+	}
+}
+
+void D3DUTAPI d3dut_set_ps_constant_buffers(unsigned int start, unsigned int count, ID3D11Buffer *const *bufs)
+{
+	if(use_state_cache) {
+		state_cache.set_ps_constant_buffers(start, count, bufs);
+	} else {
+		d3dut_ctx->PSSetConstantBuffers(start, count, bufs);
+	}
+}
+
+
+#define RQ_FIELD(x, bits)	((unsigned long long)((x) < (1u << (bits)) ? (x) : (1u << (bits)) - 1))
+
+unsigned long long D3DUTAPI d3dut_rq_key(unsigned int pass, unsigned int depth, unsigned int shader,
+		unsigned int material, unsigned int mesh)
+{
+	unsigned long long key = RQ_FIELD(pass, D3DUT_RQ_PASS_BITS);
+	key = (key << D3DUT_RQ_DEPTH_BITS) | RQ_FIELD(depth, D3DUT_RQ_DEPTH_BITS);
+	key = (key << D3DUT_RQ_SHADER_BITS) | RQ_FIELD(shader, D3DUT_RQ_SHADER_BITS);
+	key = (key << D3DUT_RQ_MATERIAL_BITS) | RQ_FIELD(material, D3DUT_RQ_MATERIAL_BITS);
+	key = (key << D3DUT_RQ_MESH_BITS) | RQ_FIELD(mesh, D3DUT_RQ_MESH_BITS);
+	return key;
+}
+
+void D3DUTAPI d3dut_rq_submit(unsigned long long key, D3DUT_DrawFunc func, void *cls)
+{
+	rqueue.submit(key, func, cls);
+}
+
+void D3DUTAPI d3dut_rq_flush()
+{
+	rqueue.sort();
+	rqueue.replay();
+	rqueue.clear();
+}
+
+
+void D3DUTAPI d3dut_optimize_vertex_cache(unsigned int *indices, int nidx, int nverts)
+{
+	optimize_vertex_cache(indices, nidx, nverts);
+}
+
+int D3DUTAPI d3dut_optimize_vertex_fetch(void *verts, int nverts, int vert_size, unsigned int *indices, int nidx)
+{
+	return optimize_vertex_fetch(verts, nverts, vert_size, indices, nidx);
+}
+
+void D3DUTAPI d3dut_analyze_vertex_cache(const unsigned int *indices, int nidx, int nverts, int cache_size,
+		float *acmr, float *atvr)
+{
+	analyze_vertex_cache(indices, nidx, nverts, cache_size, acmr, atvr);
+}
+
+
+ID3D11ShaderResourceView D3DUTAPI *d3dut_create_texture(int xsz, int ysz, const unsigned char *pixels,
+		int filter, unsigned int flags, float alpha_ref)
+{
+	return create_texture(xsz, ysz, pixels, filter, flags, alpha_ref);
+}
+
+size_t D3DUTAPI d3dut_bc_size(int format, int xsz, int ysz)
+{
+	return bc_size(format, xsz, ysz);
+}
+
+void D3DUTAPI d3dut_bc_encode(int format, int mode, int xsz, int ysz, const unsigned char *pixels, void *dest)
+{
+	bc_encode(format, mode == D3DUT_BC_QUALITY, xsz, ysz, pixels, (unsigned char*)dest);
+}
+
+void D3DUTAPI d3dut_bc_cache_size(size_t max_bytes)
+{
+	bc_set_cache_size(max_bytes);
+}
+
+void D3DUTAPI d3dut_frustum(const float *matrix, D3DUT_Frustum *frustum)
+{
+	frustum_from_matrix(matrix, frustum);
+}
+
+int D3DUTAPI d3dut_cull_spheres(const D3DUT_Frustum *frustum, const D3DUT_Spheres *spheres, int count, int *visible)
+{
+	return cull_spheres(frustum, spheres, count, visible);
+}
+
+int D3DUTAPI d3dut_cull_aabbs(const D3DUT_Frustum *frustum, const D3DUT_AABBs *boxes, int count, int *visible)
+{
+	return cull_aabbs(frustum, boxes, count, visible);
+}
+
+D3DUT_Mesh D3DUTAPI *d3dut_load_mesh(const char *fname)
+{
+	return load_mesh(fname);
+}
+
+void D3DUTAPI d3dut_free_mesh(D3DUT_Mesh *mesh)
+{
+	free_mesh(mesh);
+}
+
+void D3DUTAPI d3dut_draw_mesh(const D3DUT_Mesh *mesh)
+{
+	draw_mesh(mesh);
+}
+
+
 void D3DUTAPI d3dut_solid_sphere(double radius, int slices, int stacks)
 {
+	Shape *shape = get_shape(SHAPE_SPHERE, radius, slices, stacks);
+	if(shape) {
+		draw_shape(shape);
+	}
+}
+
+void D3DUTAPI d3dut_solid_sphere_instanced(double radius, int slices, int stacks,
+		const float *xforms, const float *colors, int count)
+{
+	Shape *shape = get_shape(SHAPE_SPHERE, radius, slices, stacks);
+	if(shape) {
+		draw_shape_instanced(shape, xforms, colors, count);
+	}
+}
+
+int D3DUTAPI d3dut_shape_input_layout(int instanced, const D3D11_INPUT_ELEMENT_DESC **layout)
+{
+	return get_shape_layout(instanced != 0, layout);
 }
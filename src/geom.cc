@@ -0,0 +1,332 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include "d3dut.h"
+#include "geom.h"
+#include "meshopt.h"
+#include "thrpool.h"
+#include "logmsg.h"
+
+#ifndef M_PI
+#define M_PI	3.14159265358979323846
+#endif
+
+#define PAR_PACK_THRES	8192
+#define MIN_INST_BUF	1024
+
+static MemVector<Shape*, MEM_GEOMETRY>::type shapes;
+
+static ID3D11Buffer *inst_buf;
+static int inst_buf_size;	// in instances
+
+static const D3D11_INPUT_ELEMENT_DESC shape_layout[] = {
+	{"position", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(ShapeVertex, pos), D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"normal", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(ShapeVertex, normal), D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"texcoord", 0, DXGI_FORMAT_R32G32_FLOAT, 0, offsetof(ShapeVertex, texcoord), D3D11_INPUT_PER_VERTEX_DATA, 0},
+	{"instance_xform", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(ShapeInstance, xform[0]), D3D11_INPUT_PER_INSTANCE_DATA, 1},
+	{"instance_xform", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(ShapeInstance, xform[1]), D3D11_INPUT_PER_INSTANCE_DATA, 1},
+	{"instance_xform", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, offsetof(ShapeInstance, xform[2]), D3D11_INPUT_PER_INSTANCE_DATA, 1},
+	{"instance_color", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 1, offsetof(ShapeInstance, color), D3D11_INPUT_PER_INSTANCE_DATA, 1}
+};
+#define NUM_VERTEX_ATTR		3
+#define NUM_INSTANCE_ATTR	4
+
+static void optimize(ShapeVertexArray *verts, ShapeIndexArray *indices)
+{
+	if(indices->empty()) return;
+
+	optimize_vertex_cache(&(*indices)[0], (int)indices->size(), (int)verts->size());
+	int nverts = optimize_vertex_fetch(&(*verts)[0], (int)verts->size(), sizeof(ShapeVertex),
+			&(*indices)[0], (int)indices->size());
+	verts->resize(nverts);
+}
+
+void gen_sphere(ShapeVertexArray *verts, ShapeIndexArray *indices,
+		double radius, int slices, int stacks)
+{
+	if(slices < 3) slices = 3;
+	if(stacks < 2) stacks = 2;
+
+	int ucount = slices + 1;
+	int vcount = stacks + 1;
+
+	verts->resize(ucount * vcount);
+	ShapeVertex *vptr = &(*verts)[0];
+
+	for(int i=0; i<vcount; i++) {
+		float v = (float)i / (float)stacks;
+		double phi = v * M_PI;
+
+		for(int j=0; j<ucount; j++) {
+			float u = (float)j / (float)slices;
+			double theta = u * 2.0 * M_PI;
+
+			float nx = (float)(sin(theta) * sin(phi));
+			float ny = (float)cos(phi);
+			float nz = (float)(cos(theta) * sin(phi));
+
+			vptr->pos[0] = (float)(nx * radius);
+			vptr->pos[1] = (float)(ny * radius);
+			vptr->pos[2] = (float)(nz * radius);
+			vptr->normal[0] = nx;
+			vptr->normal[1] = ny;
+			vptr->normal[2] = nz;
+			vptr->texcoord[0] = u;
+			vptr->texcoord[1] = v;
+			vptr++;
+		}
+	}
+
+	indices->clear();
+	indices->reserve(slices * stacks * 6);
+
+	for(int i=0; i<stacks; i++) {
+		for(int j=0; j<slices; j++) {
+			unsigned int a = i * ucount + j;
+			unsigned int b = a + 1;
+			unsigned int c = a + ucount;
+			unsigned int d = c + 1;
+
+			// the top and bottom stacks degenerate into a single triangle per slice
+			if(i > 0) {
+				indices->push_back(a);
+				indices->push_back(b);
+				indices->push_back(d);
+			}
+			if(i < stacks - 1) {
+				indices->push_back(a);
+				indices->push_back(d);
+				indices->push_back(c);
+			}
+		}
+	}
+
+	optimize(verts, indices);
+}
+
+static Shape *create_shape(int type, double size, int usub, int vsub)
+{
+	ShapeVertexArray verts;
+	ShapeIndexArray indices;
+
+	switch(type) {
+	case SHAPE_SPHERE:
+		gen_sphere(&verts, &indices, size, usub, vsub);
+		break;
+
+	default:
+		return 0;
+	}
+
+	Shape *shape = mem_new<Shape>(MEM_GEOMETRY);
+	shape->type = type;
+	shape->size = size;
+	shape->usub = usub;
+	shape->vsub = vsub;
+	shape->nverts = (int)verts.size();
+	shape->nidx = (int)indices.size();
+
+	D3D11_BUFFER_DESC buf_desc;
+	memset(&buf_desc, 0, sizeof buf_desc);
+	buf_desc.Usage = D3D11_USAGE_IMMUTABLE;
+	buf_desc.ByteWidth = shape->nverts * sizeof(ShapeVertex);
+	buf_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA subdata;
+	memset(&subdata, 0, sizeof subdata);
+	subdata.pSysMem = &verts[0];
+	if(d3dut_dev->CreateBuffer(&buf_desc, &subdata, &shape->vbuf) != 0) {
+		warning("failed to create shape vertex buffer\n");
+		mem_delete(shape);
+		return 0;
+	}
+
+	buf_desc.ByteWidth = shape->nidx * sizeof(unsigned int);
+	buf_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	subdata.pSysMem = &indices[0];
+	if(d3dut_dev->CreateBuffer(&buf_desc, &subdata, &shape->ibuf) != 0) {
+		warning("failed to create shape index buffer\n");
+		shape->vbuf->Release();
+		mem_delete(shape);
+		return 0;
+	}
+
+	return shape;
+}
+
+Shape *get_shape(int type, double size, int usub, int vsub)
+{
+	for(size_t i=0; i<shapes.size(); i++) {
+		Shape *s = shapes[i];
+		if(s->type == type && s->size == size && s->usub == usub && s->vsub == vsub) {
+			return s;
+		}
+	}
+
+	Shape *shape = create_shape(type, size, usub, vsub);
+	if(shape) {
+		shapes.push_back(shape);
+	}
+	return shape;
+}
+
+void draw_shape(const Shape *shape)
+{
+	unsigned int stride = sizeof(ShapeVertex);
+	unsigned int offset = 0;
+	d3dut_set_vertex_buffers(0, 1, &shape->vbuf, &stride, &offset);
+	d3dut_set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	d3dut_ctx->IASetIndexBuffer(shape->ibuf, DXGI_FORMAT_R32_UINT, 0);
+
+	d3dut_ctx->DrawIndexed(shape->nidx, 0, 0);
+}
+
+static inline unsigned int pack_unorm8(float x)
+{
+	if(x <= 0.0f) return 0;
+	if(x >= 1.0f) return 255;
+	return (unsigned int)(x * 255.0f + 0.5f);
+}
+
+static void pack_instances(ShapeInstance *dest, const float *xforms, const float *colors, int count)
+{
+	for(int i=0; i<count; i++) {
+		memcpy(dest->xform, xforms, sizeof dest->xform);
+		xforms += 16;
+
+		if(colors) {
+			dest->color = pack_unorm8(colors[0]) | (pack_unorm8(colors[1]) << 8) |
+				(pack_unorm8(colors[2]) << 16) | (pack_unorm8(colors[3]) << 24);
+			colors += 4;
+		} else {
+			dest->color = 0xffffffff;
+		}
+		dest++;
+	}
+}
+
+struct PackJob {
+	ShapeInstance *dest;
+	const float *xforms, *colors;
+	int count, chunk_size;
+};
+
+static void pack_job(int job, void *cls)
+{
+	PackJob *pj = (PackJob*)cls;
+
+	int start = job * pj->chunk_size;
+	int end = start + pj->chunk_size;
+	if(end > pj->count) end = pj->count;
+	if(start >= end) return;
+
+	pack_instances(pj->dest + start, pj->xforms + start * 16,
+			pj->colors ? pj->colors + start * 4 : 0, end - start);
+}
+
+static bool alloc_instance_buffer(int count)
+{
+	if(inst_buf && inst_buf_size >= count) {
+		return true;
+	}
+
+	int size = inst_buf_size > MIN_INST_BUF ? inst_buf_size : MIN_INST_BUF;
+	while(size < count) {
+		size *= 2;
+	}
+
+	D3D11_BUFFER_DESC buf_desc;
+	memset(&buf_desc, 0, sizeof buf_desc);
+	buf_desc.Usage = D3D11_USAGE_DYNAMIC;
+	buf_desc.ByteWidth = size * sizeof(ShapeInstance);
+	buf_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	buf_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	ID3D11Buffer *buf;
+	if(d3dut_dev->CreateBuffer(&buf_desc, 0, &buf) != 0) {
+		warning("failed to create instance buffer (%d instances)\n", size);
+		return false;
+	}
+	if(inst_buf) {
+		inst_buf->Release();
+	}
+	inst_buf = buf;
+	inst_buf_size = size;
+	return true;
+}
+
+void draw_shape_instanced(const Shape *shape, const float *xforms, const float *colors, int count)
+{
+	if(count <= 0 || !alloc_instance_buffer(count)) {
+		return;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE map;
+	if(d3dut_ctx->Map(inst_buf, 0, D3D11_MAP_WRITE_DISCARD, 0, &map) != 0) {
+		warning("failed to map instance buffer\n");
+		return;
+	}
+	ShapeInstance *dest = (ShapeInstance*)map.pData;
+
+	if(count >= PAR_PACK_THRES) {
+		ThreadPool *tpool = get_thread_pool();
+		int njobs = tpool->get_num_threads();
+
+		PackJob pj;
+		pj.dest = dest;
+		pj.xforms = xforms;
+		pj.colors = colors;
+		pj.count = count;
+		pj.chunk_size = (count + njobs - 1) / njobs;
+		tpool->run(njobs, pack_job, &pj);
+	} else {
+		pack_instances(dest, xforms, colors, count);
+	}
+	d3dut_ctx->Unmap(inst_buf, 0);
+
+	ID3D11Buffer *bufs[] = {shape->vbuf, inst_buf};
+	unsigned int strides[] = {sizeof(ShapeVertex), sizeof(ShapeInstance)};
+	unsigned int offsets[] = {0, 0};
+	d3dut_set_vertex_buffers(0, 2, bufs, strides, offsets);
+	d3dut_set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	d3dut_ctx->IASetIndexBuffer(shape->ibuf, DXGI_FORMAT_R32_UINT, 0);
+
+	d3dut_ctx->DrawIndexedInstanced(shape->nidx, count, 0, 0, 0);
+}
+
+int get_shape_layout(bool instanced, const D3D11_INPUT_ELEMENT_DESC **layout)
+{
+	*layout = shape_layout;
+	return instanced ? NUM_VERTEX_ATTR + NUM_INSTANCE_ATTR : NUM_VERTEX_ATTR;
+}
+
+void destroy_shapes()
+{
+	if(inst_buf) {
+		inst_buf->Release();
+		inst_buf = 0;
+		inst_buf_size = 0;
+	}
+
+	for(size_t i=0; i<shapes.size(); i++) {
+		shapes[i]->vbuf->Release();
+		shapes[i]->ibuf->Release();
+		mem_delete(shapes[i]);
+	}
+	shapes.clear();
+}
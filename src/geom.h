@@ -0,0 +1,68 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_GEOM_H_
+#define D3DUT_GEOM_H_
+
+#include <d3d11.h>
+#include "alloc.h"
+
+enum {
+	SHAPE_SPHERE
+};
+
+struct ShapeVertex {
+	float pos[3];
+	float normal[3];
+	float texcoord[2];
+};
+
+// per-instance data of instanced shapes, in vertex buffer slot 1
+struct ShapeInstance {
+	float xform[3][4];		// top three rows of the transformation matrix
+	unsigned int color;		// RGBA8
+};
+
+struct Shape {
+	int type;
+	double size;
+	int usub, vsub;
+
+	ID3D11Buffer *vbuf, *ibuf;
+	int nverts, nidx;
+};
+
+typedef MemVector<ShapeVertex, MEM_GEOMETRY>::type ShapeVertexArray;
+typedef MemVector<unsigned int, MEM_GEOMETRY>::type ShapeIndexArray;
+
+// generate the mesh of a sphere, with its triangles already optimized
+void gen_sphere(ShapeVertexArray *verts, ShapeIndexArray *indices,
+		double radius, int slices, int stacks);
+
+// returns a cached shape matching the arguments, creating it on first use
+Shape *get_shape(int type, double size, int usub, int vsub);
+void draw_shape(const Shape *shape);
+/* xforms: count 4x4 matrices, colors: count RGBA colors or null for white.
+ * Packed into a shared dynamic instance buffer, on multiple threads for
+ * large counts, and drawn with a single DrawIndexedInstanced.
+ */
+void draw_shape_instanced(const Shape *shape, const float *xforms, const float *colors, int count);
+// input layout matching the shape vertices, and optionally the instance data
+int get_shape_layout(bool instanced, const D3D11_INPUT_ELEMENT_DESC **layout);
+void destroy_shapes();
+
+#endif	// D3DUT_GEOM_H_
@@ -0,0 +1,32 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_IMGENC_H_
+#define D3DUT_IMGENC_H_
+
+#include "alloc.h"
+
+typedef MemVector<unsigned char, MEM_CAPTURE>::type ImgBuffer;
+
+/* image encoders for 8-bit RGBA pixels, with rows top to bottom and pitch
+ * bytes apart. The encoded file is appended to out.
+ */
+void encode_png(const unsigned char *pixels, int width, int height, int pitch, ImgBuffer *out);
+void encode_qoi(const unsigned char *pixels, int width, int height, int pitch, ImgBuffer *out);
+void encode_raw(const unsigned char *pixels, int width, int height, int pitch, ImgBuffer *out);
+
+#endif	// D3DUT_IMGENC_H_
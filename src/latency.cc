@@ -0,0 +1,109 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <windows.h>
+#include "latency.h"
+
+InputLatency::InputLatency()
+{
+	for(int i=0; i<NUM_INPUT_TYPES; i++) {
+		pending[i] = consumed[i] = -1;
+	}
+}
+
+void InputLatency::reset()
+{
+	for(int i=0; i<NUM_INPUT_TYPES; i++) {
+		hist[i].reset();
+	}
+}
+
+void InputLatency::input_event(int type, long long arrival)
+{
+	if(pending[type] < 0 || arrival < pending[type]) {
+		pending[type] = arrival;
+	}
+}
+
+void InputLatency::begin_frame()
+{
+	for(int i=0; i<NUM_INPUT_TYPES; i++) {
+		if(pending[i] < 0) continue;
+
+		// keep events consumed by a previous frame which was never presented
+		if(consumed[i] < 0 || pending[i] < consumed[i]) {
+			consumed[i] = pending[i];
+		}
+		pending[i] = -1;
+	}
+}
+
+void InputLatency::present()
+{
+	long long now = get_timer_ticks();
+
+	for(int i=0; i<NUM_INPUT_TYPES; i++) {
+		if(consumed[i] >= 0) {
+			hist[i].record(ticks_to_nsec(now - consumed[i]));
+			consumed[i] = -1;
+		}
+	}
+}
+
+void InputLatency::get_stats(int type, D3DUT_TimeStats *stats) const
+{
+	hist[type].get_stats(stats);
+}
+
+static long long msg_arrival = -1;
+static long tick_msec;
+
+long long message_arrival_time(DWORD msg_time)
+{
+	long long now = get_timer_ticks();
+
+	/* GetTickCount and the message time advance in steps of the system timer
+	 * interval (usually 15.6ms), so their difference is only meaningful when
+	 * it's more than a step. In that case the message sat in the queue while
+	 * the loop was busy, and the correction is worth its error of up to one
+	 * step; otherwise the time it was pulled off the queue is closer.
+	 */
+	if(!tick_msec) {
+		DWORD adj, incr;
+		BOOL disabled;
+		GetSystemTimeAdjustment(&adj, &incr, &disabled);
+		tick_msec = (long)((incr + 9999) / 10000);	// 100ns units
+		if(tick_msec < 1) tick_msec = 1;
+	}
+
+	long queued = (long)(GetTickCount() - msg_time);
+	if(queued > tick_msec) {
+		now -= nsec_to_ticks((unsigned long long)queued * 1000000);
+	}
+	return now;
+}
+
+void set_input_arrival(long long arrival)
+{
+	msg_arrival = arrival;
+}
+
+long long input_arrival_time()
+{
+	// messages sent straight to the window never went through the main loop
+	return msg_arrival >= 0 ? msg_arrival : get_timer_ticks();
+}
@@ -0,0 +1,67 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_LATENCY_H_
+#define D3DUT_LATENCY_H_
+
+#include <windows.h>
+#include "timestats.h"
+
+// input event types, must match D3DUT_INPUT_* in d3dut.h
+enum {
+	INPUT_KEYBOARD,
+	INPUT_MOUSE_BUTTON,
+	INPUT_MOUSE_MOTION,
+
+	NUM_INPUT_TYPES
+};
+
+/* Input-to-present latency of a window. Each input event is stamped with its
+ * arrival time, the next frame drawn consumes all pending events, and the
+ * swap_buffers call which presents that frame records, for each event type,
+ * the latency of the oldest event consumed.
+ */
+class InputLatency {
+private:
+	long long pending[NUM_INPUT_TYPES];		// oldest event not yet seen by a frame, or -1
+	long long consumed[NUM_INPUT_TYPES];	// oldest event consumed by the current frame, or -1
+	TimeHistogram hist[NUM_INPUT_TYPES];
+
+public:
+	InputLatency();
+
+	void reset();
+
+	void input_event(int type, long long arrival);
+	void begin_frame();
+	void present();
+
+	void get_stats(int type, D3DUT_TimeStats *stats) const;
+};
+
+/* The main loop stamps each message as it pulls it off the queue:
+ * message_arrival_time gives the arrival time (in timer ticks) of a message
+ * with the time stamp msg_time, and set_input_arrival makes it the result of
+ * input_arrival_time while the message is dispatched (-1 clears it).
+ */
+long long message_arrival_time(DWORD msg_time);
+void set_input_arrival(long long arrival);
+
+// arrival time of the message currently being processed
+long long input_arrival_time();
+
+#endif	// D3DUT_LATENCY_H_
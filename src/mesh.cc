@@ -0,0 +1,176 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <string.h>
+#include "mesh.h"
+#include "meshfile.h"
+#include "logmsg.h"
+#include "alloc.h"
+
+static bool check_header(const MeshFileHeader *hdr, uint64_t fsize, const char *fname);
+
+/* the file is mapped into memory and the vertex/index buffers are created
+ * straight from the mapping, without any intermediate copies.
+ */
+D3DUT_Mesh *load_mesh(const char *fname)
+{
+	HANDLE fd = CreateFile(fname, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if(fd == INVALID_HANDLE_VALUE) {
+		warning("failed to open mesh file: %s\n", fname);
+		return 0;
+	}
+
+	LARGE_INTEGER fsize;
+	if(!GetFileSizeEx(fd, &fsize) || (uint64_t)fsize.QuadPart < sizeof(MeshFileHeader)) {
+		warning("invalid mesh file: %s\n", fname);
+		CloseHandle(fd);
+		return 0;
+	}
+
+	HANDLE fmap = CreateFileMapping(fd, 0, PAGE_READONLY, 0, 0, 0);
+	CloseHandle(fd);
+	if(!fmap) {
+		warning("failed to map mesh file: %s\n", fname);
+		return 0;
+	}
+	const char *data = (const char*)MapViewOfFile(fmap, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(fmap);
+	if(!data) {
+		warning("failed to map mesh file: %s\n", fname);
+		return 0;
+	}
+
+	const MeshFileHeader *hdr = (const MeshFileHeader*)data;
+	if(!check_header(hdr, fsize.QuadPart, fname)) {
+		UnmapViewOfFile(data);
+		return 0;
+	}
+
+	D3DUT_Mesh *mesh = mem_new<D3DUT_Mesh>(MEM_GEOMETRY);
+	memset(mesh, 0, sizeof *mesh);
+	mesh->nverts = hdr->num_verts;
+	mesh->nidx = hdr->num_indices;
+	mesh->vertex_size = hdr->vertex_size;
+	mesh->index_format = hdr->index_size == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	memcpy(mesh->bbox_min, hdr->bbox_min, sizeof mesh->bbox_min);
+	memcpy(mesh->bbox_max, hdr->bbox_max, sizeof mesh->bbox_max);
+	memcpy(mesh->bsph_center, hdr->bsph_center, sizeof mesh->bsph_center);
+	mesh->bsph_radius = hdr->bsph_radius;
+
+	mesh->num_attr = hdr->num_attr;
+	for(int i=0; i<mesh->num_attr; i++) {
+		const MeshFileAttr *attr = hdr->attr + i;
+		D3D11_INPUT_ELEMENT_DESC *desc = mesh->layout + i;
+
+		memcpy(mesh->semantic[i], attr->semantic, MESHFILE_SEMANTIC_LEN);
+		mesh->semantic[i][MESHFILE_SEMANTIC_LEN - 1] = 0;
+
+		desc->SemanticName = mesh->semantic[i];
+		desc->SemanticIndex = attr->semantic_index;
+		desc->Format = (DXGI_FORMAT)attr->format;
+		desc->InputSlot = 0;
+		desc->AlignedByteOffset = attr->offset;
+		desc->InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+		desc->InstanceDataStepRate = 0;
+	}
+
+	D3D11_BUFFER_DESC buf_desc;
+	memset(&buf_desc, 0, sizeof buf_desc);
+	buf_desc.Usage = D3D11_USAGE_IMMUTABLE;
+	buf_desc.ByteWidth = hdr->num_verts * hdr->vertex_size;
+	buf_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA subdata;
+	memset(&subdata, 0, sizeof subdata);
+	subdata.pSysMem = data + hdr->vertex_offs;
+	if(d3dut_dev->CreateBuffer(&buf_desc, &subdata, &mesh->vbuf) != 0) {
+		warning("failed to create vertex buffer for mesh: %s\n", fname);
+		goto err;
+	}
+
+	if(hdr->num_indices) {
+		buf_desc.ByteWidth = hdr->num_indices * hdr->index_size;
+		buf_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		subdata.pSysMem = data + hdr->index_offs;
+		if(d3dut_dev->CreateBuffer(&buf_desc, &subdata, &mesh->ibuf) != 0) {
+			warning("failed to create index buffer for mesh: %s\n", fname);
+			goto err;
+		}
+	}
+
+	UnmapViewOfFile(data);
+	return mesh;
+
+err:
+	UnmapViewOfFile(data);
+	free_mesh(mesh);
+	return 0;
+}
+
+static bool check_header(const MeshFileHeader *hdr, uint64_t fsize, const char *fname)
+{
+	if(memcmp(hdr->magic, MESHFILE_MAGIC, sizeof hdr->magic) != 0) {
+		warning("%s is not a d3dut mesh file\n", fname);
+		return false;
+	}
+	if(hdr->version != MESHFILE_VERSION) {
+		warning("%s: unsupported mesh file version: %u\n", fname, hdr->version);
+		return false;
+	}
+	if(hdr->num_attr < 1 || hdr->num_attr > MESHFILE_MAX_ATTR || !hdr->vertex_size || !hdr->num_verts ||
+			(hdr->index_size != 2 && hdr->index_size != 4)) {
+		warning("%s: invalid mesh file header\n", fname);
+		return false;
+	}
+
+	uint64_t vsize = (uint64_t)hdr->num_verts * hdr->vertex_size;
+	uint64_t isize = (uint64_t)hdr->num_indices * hdr->index_size;
+	if(hdr->vertex_offs > fsize || vsize > fsize - hdr->vertex_offs ||
+			hdr->index_offs > fsize || isize > fsize - hdr->index_offs) {
+		warning("%s: truncated mesh file\n", fname);
+		return false;
+	}
+	return true;
+}
+
+void free_mesh(D3DUT_Mesh *mesh)
+{
+	if(!mesh) return;
+
+	if(mesh->vbuf) {
+		mesh->vbuf->Release();
+	}
+	if(mesh->ibuf) {
+		mesh->ibuf->Release();
+	}
+	mem_delete(mesh);
+}
+
+void draw_mesh(const D3DUT_Mesh *mesh)
+{
+	unsigned int offset = 0;
+	d3dut_set_vertex_buffers(0, 1, &mesh->vbuf, &mesh->vertex_size, &offset);
+	d3dut_set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	if(mesh->ibuf) {
+		d3dut_ctx->IASetIndexBuffer(mesh->ibuf, mesh->index_format, 0);
+		d3dut_ctx->DrawIndexed(mesh->nidx, 0, 0);
+	} else {
+		d3dut_ctx->Draw(mesh->nverts, 0);
+	}
+}
@@ -0,0 +1,27 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_MESH_H_
+#define D3DUT_MESH_H_
+
+#include "d3dut.h"
+
+D3DUT_Mesh *load_mesh(const char *fname);
+void free_mesh(D3DUT_Mesh *mesh);
+void draw_mesh(const D3DUT_Mesh *mesh);
+
+#endif	// D3DUT_MESH_H_
@@ -0,0 +1,66 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_MESHFILE_H_
+#define D3DUT_MESHFILE_H_
+
+/* d3dut binary mesh file layout (little endian):
+ *  - MeshFileHeader at offset 0
+ *  - vertex data at vertex_offs, num_verts * vertex_size bytes
+ *  - index data at index_offs, num_indices * index_size bytes
+ * Both data blobs are aligned to MESHFILE_ALIGN bytes from the start of the
+ * file, and are in the exact format expected by the vertex/index buffers.
+ */
+
+#define MESHFILE_MAGIC		"D3DUTMSH"
+#define MESHFILE_VERSION	1
+#define MESHFILE_ALIGN		64
+#define MESHFILE_MAX_ATTR	8
+#define MESHFILE_SEMANTIC_LEN	16
+
+#include <stdint.h>
+
+struct MeshFileAttr {
+	char semantic[MESHFILE_SEMANTIC_LEN];	// nul-terminated
+	uint32_t semantic_index;
+	uint32_t format;	// DXGI_FORMAT
+	uint32_t offset;	// byte offset within the vertex
+	uint32_t reserved;
+};
+
+struct MeshFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t num_attr;
+
+	uint32_t vertex_size;
+	uint32_t num_verts;
+	uint32_t index_size;	// 2 or 4
+	uint32_t num_indices;
+
+	uint64_t vertex_offs;
+	uint64_t index_offs;
+
+	float bbox_min[3], bbox_max[3];
+	float bsph_center[3], bsph_radius;
+
+	MeshFileAttr attr[MESHFILE_MAX_ATTR];
+};
+
+#define MESHFILE_ALIGN_OFFS(x)	(((x) + MESHFILE_ALIGN - 1) & ~(uint64_t)(MESHFILE_ALIGN - 1))
+
+#endif	// D3DUT_MESHFILE_H_
@@ -0,0 +1,230 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "meshopt.h"
+#include "alloc.h"
+
+#define CACHE_DECAY_POWER	1.5f
+#define LAST_TRI_SCORE		0.75f
+#define VALENCE_BOOST_SCALE	2.0f
+#define VALENCE_BOOST_POWER	0.5f
+
+struct OptVertex {
+	int cache_pos;		// -1 if not in the cache
+	float score;
+	int tris_left;		// triangles not yet added, which use this vertex
+	int adj_start;		// start of the adjacent triangles list in the adjacency array
+};
+
+static float vertex_score(const OptVertex *v)
+{
+	if(v->tris_left <= 0) {
+		return -1.0f;	// no triangles need this vertex anymore
+	}
+
+	float score = 0.0f;
+	if(v->cache_pos >= 0) {
+		if(v->cache_pos < 3) {
+			// used by the last triangle; fixed score to discourage using it again immediately
+			score = LAST_TRI_SCORE;
+		} else {
+			const float scaler = 1.0f / (VCACHE_SIZE - 3);
+			score = 1.0f - (v->cache_pos - 3) * scaler;
+			score = powf(score, CACHE_DECAY_POWER);
+		}
+	}
+
+	// bonus for vertices with few triangles left, to get rid of lone triangles quickly
+	score += VALENCE_BOOST_SCALE * powf((float)v->tris_left, -VALENCE_BOOST_POWER);
+	return score;
+}
+
+void optimize_vertex_cache(unsigned int *indices, int nidx, int nverts)
+{
+	int ntris = nidx / 3;
+	if(ntris < 2) return;
+
+	MemVector<OptVertex, MEM_GEOMETRY>::type verts(nverts);
+	MemVector<int, MEM_GEOMETRY>::type adj(nidx);
+	MemVector<float, MEM_GEOMETRY>::type tri_score(ntris);
+	MemVector<char, MEM_GEOMETRY>::type tri_added(ntris);
+	MemVector<unsigned int, MEM_GEOMETRY>::type out;
+	out.reserve(nidx);
+
+	// build vertex -> triangle adjacency
+	memset(&verts[0], 0, nverts * sizeof verts[0]);
+	for(int i=0; i<ntris * 3; i++) {
+		verts[indices[i]].tris_left++;
+	}
+	int offs = 0;
+	for(int i=0; i<nverts; i++) {
+		verts[i].adj_start = offs;
+		offs += verts[i].tris_left;
+		verts[i].tris_left = 0;
+		verts[i].cache_pos = -1;
+	}
+	for(int i=0; i<ntris; i++) {
+		for(int j=0; j<3; j++) {
+			OptVertex *v = &verts[indices[i * 3 + j]];
+			adj[v->adj_start + v->tris_left++] = i;
+		}
+	}
+
+	for(int i=0; i<nverts; i++) {
+		verts[i].score = vertex_score(&verts[i]);
+	}
+	for(int i=0; i<ntris; i++) {
+		const unsigned int *tri = indices + i * 3;
+		tri_score[i] = verts[tri[0]].score + verts[tri[1]].score + verts[tri[2]].score;
+	}
+
+	// the simulated LRU cache, with room for a triangle's worth of overflow
+	int cache[VCACHE_SIZE + 3];
+	int cache_len = 0;
+
+	int best_tri = -1;
+	float best_score = -1.0f;
+	for(int i=0; i<ntris; i++) {
+		if(tri_score[i] > best_score) {
+			best_score = tri_score[i];
+			best_tri = i;
+		}
+	}
+	int scan_pos = 0;	// everything before this has been added already
+
+	while(best_tri >= 0) {
+		const unsigned int *tri = indices + best_tri * 3;
+		tri_added[best_tri] = true;
+		out.push_back(tri[0]);
+		out.push_back(tri[1]);
+		out.push_back(tri[2]);
+
+		// move the triangle's vertices to the front of the cache
+		int new_cache[VCACHE_SIZE + 3];
+		int new_len = 0;
+		for(int i=0; i<3; i++) {
+			OptVertex *v = &verts[tri[i]];
+			new_cache[new_len++] = tri[i];
+
+			// remove this triangle from the vertex adjacency list
+			int *vadj = &adj[v->adj_start];
+			for(int j=0; j<v->tris_left; j++) {
+				if(vadj[j] == best_tri) {
+					vadj[j] = vadj[--v->tris_left];
+					break;
+				}
+			}
+		}
+		for(int i=0; i<cache_len; i++) {
+			int vidx = cache[i];
+			if(vidx != (int)tri[0] && vidx != (int)tri[1] && vidx != (int)tri[2]) {
+				new_cache[new_len++] = vidx;
+			}
+		}
+
+		// update positions and scores of everything in the cache, and of what fell out of it
+		for(int i=0; i<new_len; i++) {
+			OptVertex *v = &verts[new_cache[i]];
+			v->cache_pos = i < VCACHE_SIZE ? i : -1;
+			v->score = vertex_score(v);
+		}
+		cache_len = new_len < VCACHE_SIZE ? new_len : VCACHE_SIZE;
+		memcpy(cache, new_cache, cache_len * sizeof *cache);
+
+		// rescore the triangles using cached vertices and pick the best one
+		best_tri = -1;
+		best_score = -1.0f;
+		for(int i=0; i<cache_len; i++) {
+			OptVertex *v = &verts[cache[i]];
+			const int *vadj = &adj[v->adj_start];
+			for(int j=0; j<v->tris_left; j++) {
+				int t = vadj[j];
+				const unsigned int *ttri = indices + t * 3;
+				float score = verts[ttri[0]].score + verts[ttri[1]].score + verts[ttri[2]].score;
+				tri_score[t] = score;
+				if(score > best_score) {
+					best_score = score;
+					best_tri = t;
+				}
+			}
+		}
+
+		if(best_tri == -1) {
+			// nothing connected to the cache, start again from the next unused triangle
+			while(scan_pos < ntris && tri_added[scan_pos]) {
+				scan_pos++;
+			}
+			if(scan_pos < ntris) {
+				best_tri = scan_pos;
+			}
+		}
+	}
+
+	memcpy(indices, &out[0], ntris * 3 * sizeof *indices);
+}
+
+int optimize_vertex_fetch(void *verts, int nverts, int vert_size, unsigned int *indices, int nidx)
+{
+	MemVector<int, MEM_GEOMETRY>::type remap(nverts, -1);
+	int new_nverts = 0;
+
+	for(int i=0; i<nidx; i++) {
+		unsigned int idx = indices[i];
+		if(remap[idx] == -1) {
+			remap[idx] = new_nverts++;
+		}
+		indices[i] = remap[idx];
+	}
+
+	MemVector<char, MEM_GEOMETRY>::type tmp(new_nverts * vert_size);
+	char *src = (char*)verts;
+	for(int i=0; i<nverts; i++) {
+		if(remap[i] != -1) {
+			memcpy(&tmp[remap[i] * vert_size], src + i * vert_size, vert_size);
+		}
+	}
+	if(new_nverts) {
+		memcpy(verts, &tmp[0], new_nverts * vert_size);
+	}
+	return new_nverts;
+}
+
+void analyze_vertex_cache(const unsigned int *indices, int nidx, int nverts, int cache_size,
+		float *acmr, float *atvr)
+{
+	// FIFO cache: a vertex is in the cache if it was transformed fewer than
+	// cache_size misses ago
+	MemVector<int, MEM_GEOMETRY>::type time_stamp(nverts, -cache_size - 1);
+	int misses = 0;
+
+	for(int i=0; i<nidx; i++) {
+		unsigned int idx = indices[i];
+		if(misses - time_stamp[idx] > cache_size) {
+			time_stamp[idx] = misses++;
+		}
+	}
+
+	if(acmr) {
+		*acmr = nidx >= 3 ? (float)misses / (float)(nidx / 3) : 0.0f;
+	}
+	if(atvr) {
+		*atvr = nverts ? (float)misses / (float)nverts : 0.0f;
+	}
+}
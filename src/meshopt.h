@@ -0,0 +1,42 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_MESHOPT_H_
+#define D3DUT_MESHOPT_H_
+
+// size of the simulated post-transform cache used for optimization
+#define VCACHE_SIZE		32
+
+/* reorders triangles for post-transform vertex cache locality, using Tom
+ * Forsyth's "linear-speed vertex cache optimisation" scoring heuristic.
+ */
+void optimize_vertex_cache(unsigned int *indices, int nidx, int nverts);
+
+/* reorders vertices in order of first use by the index buffer, for better
+ * pre-transform fetch locality, and remaps the indices accordingly.
+ * Unreferenced vertices are dropped. Returns the new vertex count.
+ */
+int optimize_vertex_fetch(void *verts, int nverts, int vert_size, unsigned int *indices, int nidx);
+
+/* simulates a FIFO post-transform cache of the given size, and computes the
+ * average cache miss ratio (transformed vertices per triangle), and the
+ * average transform to vertex ratio (1.0 is optimal).
+ */
+void analyze_vertex_cache(const unsigned int *indices, int nidx, int nverts, int cache_size,
+		float *acmr, float *atvr);
+
+#endif	// D3DUT_MESHOPT_H_
@@ -0,0 +1,642 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <string.h>
+#include <mutex>
+#include <emmintrin.h>
+#include <immintrin.h>
+#include "mipmap.h"
+#include "thrpool.h"
+#include "simd.h"
+#include "logmsg.h"
+
+#ifndef M_PI
+#define M_PI	3.14159265358979323846
+#endif
+
+#define KAISER_WIDTH	3.0
+#define KAISER_ALPHA	4.0
+
+// levels with at least this many source pixels are split into row bands across threads
+#define PAR_MIP_THRES	(256 * 256)
+
+#define SRGB_ENC_BITS	14
+#define SRGB_ENC_SIZE	(1 << SRGB_ENC_BITS)
+
+#define COVERAGE_BINS	4096
+
+typedef MemVector<float, MEM_TEXTURES>::type FloatArray;
+
+// filter taps along one axis, ntaps source samples for each output sample
+struct AxisWeights {
+	int ntaps;
+	MemVector<int, MEM_TEXTURES>::type first;
+	FloatArray weights;
+};
+
+struct LevelJob {
+	// source level: either 8bit (level 0) or float
+	const unsigned char *src8;
+	const float *srcf;
+	const float *lut;	// 8bit color to linear float
+	int sw, sh, dw, dh;
+
+	const AxisWeights *wx, *wy;
+	float *tmp;		// horizontally filtered source rows, dw x sh
+	float *dst;		// dw x dh
+
+	unsigned char *out;
+	float alpha_scale;
+	bool srgb;
+
+	int rows_per_job;
+};
+
+static float srgb_dec_lut[256], linear_dec_lut[256];
+static unsigned char srgb_enc_lut[SRGB_ENC_SIZE];
+static std::once_flag luts_once;
+static bool use_avx;
+
+static void init_luts()
+{
+	for(int i=0; i<256; i++) {
+		double x = i / 255.0;
+		srgb_dec_lut[i] = (float)(x <= 0.04045 ? x / 12.92 : pow((x + 0.055) / 1.055, 2.4));
+		linear_dec_lut[i] = (float)x;
+	}
+	for(int i=0; i<SRGB_ENC_SIZE; i++) {
+		double x = (double)i / (SRGB_ENC_SIZE - 1);
+		double s = x <= 0.0031308 ? x * 12.92 : 1.055 * pow(x, 1.0 / 2.4) - 0.055;
+		srgb_enc_lut[i] = (unsigned char)(s * 255.0 + 0.5);
+	}
+	use_avx = cpu_has_avx();
+}
+
+static double bessel_i0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	double hx = x * 0.5;
+	for(int k=1; k<50; k++) {
+		term *= (hx / k) * (hx / k);
+		sum += term;
+		if(term < sum * 1e-12) break;
+	}
+	return sum;
+}
+
+// filter support and evaluation, in destination pixel units
+static double filter_support(int filter)
+{
+	switch(filter) {
+	case MIP_TRIANGLE:
+		return 1.0;
+	case MIP_KAISER:
+		return KAISER_WIDTH;
+	default:
+		break;
+	}
+	return 0.5;
+}
+
+static double filter_eval(int filter, double t)
+{
+	t = fabs(t);
+
+	switch(filter) {
+	case MIP_TRIANGLE:
+		return t < 1.0 ? 1.0 - t : 0.0;
+
+	case MIP_KAISER:
+		{
+			double r = t / KAISER_WIDTH;
+			if(r >= 1.0) return 0.0;
+			double sinc = t < 1e-6 ? 1.0 : sin(M_PI * t) / (M_PI * t);
+			return sinc * bessel_i0(KAISER_ALPHA * sqrt(1.0 - r * r)) / bessel_i0(KAISER_ALPHA);
+		}
+
+	default:
+		break;
+	}
+	return t <= 0.5 ? 1.0 : 0.0;
+}
+
+/* taps falling outside the image are folded back into the edge pixels, so that
+ * each output sample reads a contiguous window of ntaps source samples. The
+ * windows are trimmed to the widest run of nonzero weights.
+ */
+static void calc_weights(AxisWeights *aw, int src_size, int dst_size, int filter)
+{
+	double scale = (double)src_size / (double)dst_size;
+	double support = filter_support(filter) * scale;
+	int maxtaps = (int)ceil(support * 2.0) + 3;
+	if(maxtaps > src_size) maxtaps = src_size;
+
+	// first pass: untrimmed windows starting at base, and the first nonzero tap of each
+	FloatArray wfull(dst_size * maxtaps, 0.0f);
+	MemVector<int, MEM_TEXTURES>::type base(dst_size);
+	aw->first.resize(dst_size);
+	aw->ntaps = 1;
+
+	for(int i=0; i<dst_size; i++) {
+		double center = (i + 0.5) * scale;
+		int lo = (int)floor(center - support);
+		int hi = (int)ceil(center + support);
+		float *w = &wfull[i * maxtaps];
+
+		int first = lo > 0 ? lo : 0;
+		if(first > src_size - maxtaps) {
+			first = src_size - maxtaps;
+		}
+		base[i] = first;
+
+		double sum = 0.0;
+		for(int j=lo; j<=hi; j++) {
+			double x = filter_eval(filter, (j + 0.5 - center) / scale);
+			if(x == 0.0) continue;
+
+			int idx = j < 0 ? 0 : (j >= src_size ? src_size - 1 : j);
+			w[idx - first] += (float)x;
+			sum += x;
+		}
+
+		if(sum != 0.0) {
+			for(int j=0; j<maxtaps; j++) {
+				w[j] = (float)(w[j] / sum);
+			}
+		} else {
+			// filter narrower than the sample spacing, take the nearest sample
+			int idx = (int)center;
+			w[(idx < src_size ? idx : src_size - 1) - first] = 1.0f;
+		}
+
+		int nz_start = 0, nz_end = maxtaps;
+		while(nz_start < maxtaps - 1 && w[nz_start] == 0.0f) nz_start++;
+		while(nz_end > nz_start + 1 && w[nz_end - 1] == 0.0f) nz_end--;
+		if(nz_end - nz_start > aw->ntaps) {
+			aw->ntaps = nz_end - nz_start;
+		}
+		aw->first[i] = first + nz_start;
+	}
+
+	// second pass: copy the trimmed windows, shifted back where they would cross the edge
+	aw->weights.assign(dst_size * aw->ntaps, 0.0f);
+
+	for(int i=0; i<dst_size; i++) {
+		int first = aw->first[i];
+		if(first > src_size - aw->ntaps) {
+			first = src_size - aw->ntaps;
+		}
+		aw->first[i] = first;
+
+		const float *src = &wfull[i * maxtaps];
+		float *w = &aw->weights[i * aw->ntaps];
+		for(int j=0; j<aw->ntaps; j++) {
+			int k = first + j - base[i];
+			if(k >= 0 && k < maxtaps) {
+				w[j] = src[k];
+			}
+		}
+	}
+}
+
+/* source row i of the horizontal pass as floats. 8bit rows are decoded once
+ * into row (sw * 4 floats), instead of once per tap.
+ */
+static const float *source_row(const LevelJob *lj, int i, float *row)
+{
+	if(!lj->src8) {
+		return lj->srcf + i * lj->sw * 4;
+	}
+
+	const unsigned char *sptr = lj->src8 + i * lj->sw * 4;
+	for(int j=0; j<lj->sw; j++) {
+		row[j * 4] = lj->lut[sptr[0]];
+		row[j * 4 + 1] = lj->lut[sptr[1]];
+		row[j * 4 + 2] = lj->lut[sptr[2]];
+		row[j * 4 + 3] = sptr[3] * (1.0f / 255.0f);
+		sptr += 4;
+	}
+	return row;
+}
+
+// horizontal pass: each output pixel is a weighted sum of ntaps consecutive source pixels
+static void hfilter_rows_sse(const LevelJob *lj, int row_start, int row_end)
+{
+	int ntaps = lj->wx->ntaps;
+
+	FloatArray row;
+	if(lj->src8) {
+		row.resize(lj->sw * 4);
+	}
+
+	for(int i=row_start; i<row_end; i++) {
+		const float *src = source_row(lj, i, row.empty() ? 0 : &row[0]);
+		float *dptr = lj->tmp + i * lj->dw * 4;
+		const float *w = &lj->wx->weights[0];
+
+		for(int j=0; j<lj->dw; j++) {
+			const float *sptr = src + lj->wx->first[j] * 4;
+			__m128 acc = _mm_setzero_ps();
+			for(int k=0; k<ntaps; k++) {
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(sptr)));
+				sptr += 4;
+			}
+			_mm_storeu_ps(dptr, acc);
+			dptr += 4;
+			w += ntaps;
+		}
+	}
+}
+
+/* the windows of neighbouring output pixels don't line up, so each 256bit
+ * accumulator holds two output pixels, with the low and high halves loaded
+ * from the two windows.
+ */
+TARGET_AVX static void hfilter_rows_avx(const LevelJob *lj, int row_start, int row_end)
+{
+	int ntaps = lj->wx->ntaps;
+	int dw2 = lj->dw & ~1;
+
+	FloatArray row;
+	if(lj->src8) {
+		row.resize(lj->sw * 4);
+	}
+
+	for(int i=row_start; i<row_end; i++) {
+		const float *src = source_row(lj, i, row.empty() ? 0 : &row[0]);
+		float *dptr = lj->tmp + i * lj->dw * 4;
+		const float *w = &lj->wx->weights[0];
+
+		for(int j=0; j<dw2; j+=2) {
+			const float *sptr0 = src + lj->wx->first[j] * 4;
+			const float *sptr1 = src + lj->wx->first[j + 1] * 4;
+			const float *w1 = w + ntaps;
+			__m256 acc = _mm256_setzero_ps();
+			for(int k=0; k<ntaps; k++) {
+				__m256 wk = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(w[k])),
+						_mm_set1_ps(w1[k]), 1);
+				__m256 pix = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(sptr0)),
+						_mm_loadu_ps(sptr1), 1);
+				acc = _mm256_add_ps(acc, _mm256_mul_ps(wk, pix));
+				sptr0 += 4;
+				sptr1 += 4;
+			}
+			_mm256_storeu_ps(dptr, acc);
+			dptr += 8;
+			w += ntaps * 2;
+		}
+		if(dw2 < lj->dw) {
+			// odd width, one pixel left
+			const float *sptr = src + lj->wx->first[dw2] * 4;
+			__m128 acc = _mm_setzero_ps();
+			for(int k=0; k<ntaps; k++) {
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(sptr)));
+				sptr += 4;
+			}
+			_mm_storeu_ps(dptr, acc);
+		}
+	}
+	_mm256_zeroupper();
+}
+
+// vertical pass: each output row is a weighted sum of whole rows of tmp
+static void vfilter_rows_sse(const LevelJob *lj, int row_start, int row_end)
+{
+	int ntaps = lj->wy->ntaps;
+	int nfloats = lj->dw * 4;
+
+	for(int i=row_start; i<row_end; i++) {
+		const float *w = &lj->wy->weights[i * ntaps];
+		const float *src = lj->tmp + lj->wy->first[i] * nfloats;
+		float *dptr = lj->dst + i * nfloats;
+
+		for(int j=0; j<nfloats; j+=4) {
+			__m128 acc = _mm_setzero_ps();
+			const float *sptr = src + j;
+			for(int k=0; k<ntaps; k++) {
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(sptr)));
+				sptr += nfloats;
+			}
+			_mm_storeu_ps(dptr + j, acc);
+		}
+	}
+}
+
+TARGET_AVX static void vfilter_rows_avx(const LevelJob *lj, int row_start, int row_end)
+{
+	int ntaps = lj->wy->ntaps;
+	int nfloats = lj->dw * 4;
+	int nfloats8 = nfloats & ~7;
+
+	for(int i=row_start; i<row_end; i++) {
+		const float *w = &lj->wy->weights[i * ntaps];
+		const float *src = lj->tmp + lj->wy->first[i] * nfloats;
+		float *dptr = lj->dst + i * nfloats;
+
+		for(int j=0; j<nfloats8; j+=8) {
+			__m256 acc = _mm256_setzero_ps();
+			const float *sptr = src + j;
+			for(int k=0; k<ntaps; k++) {
+				acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(w[k]), _mm256_loadu_ps(sptr)));
+				sptr += nfloats;
+			}
+			_mm256_storeu_ps(dptr + j, acc);
+		}
+		if(nfloats8 < nfloats) {
+			// odd width, one pixel left
+			__m128 acc = _mm_setzero_ps();
+			const float *sptr = src + nfloats8;
+			for(int k=0; k<ntaps; k++) {
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[k]), _mm_loadu_ps(sptr)));
+				sptr += nfloats;
+			}
+			_mm_storeu_ps(dptr + nfloats8, acc);
+		}
+	}
+	_mm256_zeroupper();
+}
+
+static inline void encode_pixel(const LevelJob *lj, const float *sptr, unsigned char *dptr)
+{
+	__m128 pix = _mm_loadu_ps(sptr);
+
+	if(lj->srgb) {
+		// color through the sRGB encoding table, alpha stays linear
+		__m128 c = _mm_min_ps(_mm_max_ps(pix, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		int idx[4];
+		_mm_storeu_si128((__m128i*)idx, _mm_cvtps_epi32(_mm_mul_ps(c, _mm_set1_ps((float)(SRGB_ENC_SIZE - 1)))));
+
+		float a = sptr[3] * (lj->alpha_scale * 255.0f) + 0.5f;
+		dptr[0] = srgb_enc_lut[idx[0]];
+		dptr[1] = srgb_enc_lut[idx[1]];
+		dptr[2] = srgb_enc_lut[idx[2]];
+		dptr[3] = a <= 0.0f ? 0 : (a >= 255.0f ? 255 : (unsigned char)a);
+	} else {
+		__m128 scale = _mm_set_ps(lj->alpha_scale * 255.0f, 255.0f, 255.0f, 255.0f);
+		__m128i v = _mm_cvtps_epi32(_mm_mul_ps(pix, scale));
+		v = _mm_packs_epi32(v, v);
+		v = _mm_packus_epi16(v, v);
+		int packed = _mm_cvtsi128_si32(v);
+		memcpy(dptr, &packed, 4);
+	}
+}
+
+static void encode_rows_sse(const LevelJob *lj, int row_start, int row_end)
+{
+	for(int i=row_start; i<row_end; i++) {
+		const float *sptr = lj->dst + i * lj->dw * 4;
+		unsigned char *dptr = lj->out + i * lj->dw * 4;
+
+		for(int j=0; j<lj->dw; j++) {
+			encode_pixel(lj, sptr, dptr);
+			sptr += 4;
+			dptr += 4;
+		}
+	}
+}
+
+/* two pixels per iteration. The float part is done 8 wide; AVX has no 256bit
+ * integer packs, so the two halves are packed to bytes with SSE.
+ */
+TARGET_AVX static void encode_rows_avx(const LevelJob *lj, int row_start, int row_end)
+{
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const float ascale = lj->alpha_scale * 255.0f;
+	const __m256 scale = _mm256_set_ps(ascale, 255.0f, 255.0f, 255.0f, ascale, 255.0f, 255.0f, 255.0f);
+	const __m256 enc_scale = _mm256_set1_ps((float)(SRGB_ENC_SIZE - 1));
+	int dw2 = lj->dw & ~1;
+
+	for(int i=row_start; i<row_end; i++) {
+		const float *sptr = lj->dst + i * lj->dw * 4;
+		unsigned char *dptr = lj->out + i * lj->dw * 4;
+
+		for(int j=0; j<dw2; j+=2) {
+			__m256 pix = _mm256_loadu_ps(sptr);
+
+			if(lj->srgb) {
+				__m256 c = _mm256_min_ps(_mm256_max_ps(pix, zero), one);
+				int idx[8];
+				_mm256_storeu_si256((__m256i*)idx, _mm256_cvtps_epi32(_mm256_mul_ps(c, enc_scale)));
+
+				float a0 = sptr[3] * ascale + 0.5f;
+				float a1 = sptr[7] * ascale + 0.5f;
+				dptr[0] = srgb_enc_lut[idx[0]];
+				dptr[1] = srgb_enc_lut[idx[1]];
+				dptr[2] = srgb_enc_lut[idx[2]];
+				dptr[3] = a0 <= 0.0f ? 0 : (a0 >= 255.0f ? 255 : (unsigned char)a0);
+				dptr[4] = srgb_enc_lut[idx[4]];
+				dptr[5] = srgb_enc_lut[idx[5]];
+				dptr[6] = srgb_enc_lut[idx[6]];
+				dptr[7] = a1 <= 0.0f ? 0 : (a1 >= 255.0f ? 255 : (unsigned char)a1);
+			} else {
+				__m256i v = _mm256_cvtps_epi32(_mm256_mul_ps(pix, scale));
+				__m128i v16 = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extractf128_si256(v, 1));
+				_mm_storel_epi64((__m128i*)dptr, _mm_packus_epi16(v16, v16));
+			}
+			sptr += 8;
+			dptr += 8;
+		}
+		if(dw2 < lj->dw) {
+			// odd width, one pixel left
+			encode_pixel(lj, sptr, dptr);
+		}
+	}
+	_mm256_zeroupper();
+}
+
+static void job_rows(const LevelJob *lj, int job, int nrows, int *start, int *end)
+{
+	*start = job * lj->rows_per_job;
+	*end = *start + lj->rows_per_job;
+	if(*end > nrows) *end = nrows;
+}
+
+static void hfilter_job(int job, void *cls)
+{
+	LevelJob *lj = (LevelJob*)cls;
+	int start, end;
+	job_rows(lj, job, lj->sh, &start, &end);
+	if(start < end) {
+		if(use_avx) {
+			hfilter_rows_avx(lj, start, end);
+		} else {
+			hfilter_rows_sse(lj, start, end);
+		}
+	}
+}
+
+static void vfilter_job(int job, void *cls)
+{
+	LevelJob *lj = (LevelJob*)cls;
+	int start, end;
+	job_rows(lj, job, lj->dh, &start, &end);
+	if(start < end) {
+		if(use_avx) {
+			vfilter_rows_avx(lj, start, end);
+		} else {
+			vfilter_rows_sse(lj, start, end);
+		}
+	}
+}
+
+static void encode_job(int job, void *cls)
+{
+	LevelJob *lj = (LevelJob*)cls;
+	int start, end;
+	job_rows(lj, job, lj->dh, &start, &end);
+	if(start < end) {
+		if(use_avx) {
+			encode_rows_avx(lj, start, end);
+		} else {
+			encode_rows_sse(lj, start, end);
+		}
+	}
+}
+
+static void run_jobs(LevelJob *lj, int nrows, ThreadJobFunc func, ThreadPool *tpool)
+{
+	int njobs = tpool ? tpool->get_num_threads() : 1;
+	lj->rows_per_job = (nrows + njobs - 1) / njobs;
+
+	if(tpool && njobs > 1) {
+		tpool->run(njobs, func, lj);
+	} else {
+		func(0, lj);
+	}
+}
+
+/* alpha scale which brings the fraction of pixels with alpha >= ref closest
+ * to the target coverage. Instead of searching for the scale, find the alpha
+ * threshold which gives the target coverage through a histogram, and map it
+ * to ref.
+ */
+static float coverage_scale(const float *pixels, size_t npix, float ref, float coverage)
+{
+	unsigned int hist[COVERAGE_BINS];
+	memset(hist, 0, sizeof hist);
+
+	for(size_t i=0; i<npix; i++) {
+		float a = pixels[i * 4 + 3];
+		int bin = (int)(a * (COVERAGE_BINS - 1));
+		hist[bin < 0 ? 0 : (bin >= COVERAGE_BINS ? COVERAGE_BINS - 1 : bin)]++;
+	}
+
+	size_t target = (size_t)(coverage * npix + 0.5f);
+	if(target == 0) {
+		return 1.0f;
+	}
+
+	size_t count = 0;
+	int bin = COVERAGE_BINS - 1;
+	while(bin > 0) {
+		count += hist[bin];
+		if(count >= target) break;
+		bin--;
+	}
+
+	float thres = (float)bin / (COVERAGE_BINS - 1);
+	if(thres <= 0.0f) {
+		return 1.0f;
+	}
+	return ref / thres;
+}
+
+bool gen_mipmaps(MipChain *chain, int xsz, int ysz, const unsigned char *pixels,
+		int filter, bool srgb, float alpha_ref)
+{
+	if(xsz <= 0 || ysz <= 0) {
+		warning("gen_mipmaps: invalid image size: %dx%d\n", xsz, ysz);
+		return false;
+	}
+	// textures may be created on the loader thread and the main thread at once
+	std::call_once(luts_once, init_luts);
+
+	// lay out the levels
+	size_t total = 0;
+	int w = xsz, h = ysz;
+	chain->num_levels = 0;
+	for(int i=0; i<MAX_MIP_LEVELS; i++) {
+		chain->width[i] = w;
+		chain->height[i] = h;
+		chain->offset[i] = total;
+		chain->num_levels++;
+		total += (size_t)w * h * 4;
+
+		if(w == 1 && h == 1) break;
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+	chain->pixels.resize(total);
+	memcpy(&chain->pixels[0], pixels, (size_t)xsz * ysz * 4);
+
+	float coverage = 0.0f;
+	if(alpha_ref > 0.0f) {
+		size_t npix = (size_t)xsz * ysz, count = 0;
+		for(size_t i=0; i<npix; i++) {
+			if(pixels[i * 4 + 3] >= alpha_ref * 255.0f) {
+				count++;
+			}
+		}
+		coverage = (float)count / (float)npix;
+	}
+
+	AxisWeights wx, wy;
+	FloatArray tmp, levels[2];
+
+	for(int i=1; i<chain->num_levels; i++) {
+		LevelJob lj;
+		memset(&lj, 0, sizeof lj);
+		lj.sw = chain->width[i - 1];
+		lj.sh = chain->height[i - 1];
+		lj.dw = chain->width[i];
+		lj.dh = chain->height[i];
+		lj.srgb = srgb;
+		lj.alpha_scale = 1.0f;
+
+		// level 0 is read directly from the 8bit image, the rest from the previous float level
+		if(i == 1) {
+			lj.src8 = pixels;
+			lj.lut = srgb ? srgb_dec_lut : linear_dec_lut;
+		} else {
+			lj.srcf = &levels[(i - 1) & 1][0];
+		}
+
+		calc_weights(&wx, lj.sw, lj.dw, filter);
+		calc_weights(&wy, lj.sh, lj.dh, filter);
+		lj.wx = &wx;
+		lj.wy = &wy;
+
+		tmp.resize((size_t)lj.dw * lj.sh * 4);
+		levels[i & 1].resize((size_t)lj.dw * lj.dh * 4);
+		lj.tmp = &tmp[0];
+		lj.dst = &levels[i & 1][0];
+		lj.out = &chain->pixels[chain->offset[i]];
+
+		ThreadPool *tpool = lj.sw * lj.sh >= PAR_MIP_THRES ? get_thread_pool() : 0;
+
+		run_jobs(&lj, lj.sh, hfilter_job, tpool);
+		run_jobs(&lj, lj.dh, vfilter_job, tpool);
+
+		if(alpha_ref > 0.0f) {
+			lj.alpha_scale = coverage_scale(lj.dst, (size_t)lj.dw * lj.dh, alpha_ref, coverage);
+		}
+		run_jobs(&lj, lj.dh, encode_job, tpool);
+	}
+	return true;
+}
@@ -0,0 +1,51 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_MIPMAP_H_
+#define D3DUT_MIPMAP_H_
+
+#include "alloc.h"
+
+#define MAX_MIP_LEVELS	16
+
+// mipmap filters, must match D3DUT_MIP_* in d3dut.h
+enum {
+	MIP_BOX,
+	MIP_TRIANGLE,
+	MIP_KAISER
+};
+
+// RGBA8 images of all mip levels, tightly packed one after the other
+struct MipChain {
+	int num_levels;
+	int width[MAX_MIP_LEVELS], height[MAX_MIP_LEVELS];
+	size_t offset[MAX_MIP_LEVELS];
+
+	MemVector<unsigned char, MEM_TEXTURES>::type pixels;
+};
+
+/* builds the full mip chain of an RGBA8 image, down to 1x1, including a copy
+ * of the original as level 0. Each level is filtered from the previous one in
+ * floating point. With srgb set, the color channels are averaged in linear
+ * space. If alpha_ref is greater than zero, the alpha of each level is scaled
+ * to keep the fraction of pixels with alpha >= alpha_ref the same as in the
+ * original image, so alpha tested cutouts don't fade away in the distance.
+ */
+bool gen_mipmaps(MipChain *chain, int xsz, int ysz, const unsigned char *pixels,
+		int filter, bool srgb, float alpha_ref);
+
+#endif	// D3DUT_MIPMAP_H_
@@ -0,0 +1,277 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include "rqueue.h"
+#include "thrpool.h"
+
+#define RADIX_BITS		8
+#define RADIX_SIZE		(1 << RADIX_BITS)
+#define RADIX_PASSES	(64 / RADIX_BITS)
+
+// below this many keys it's not worth waking up the worker threads
+#define PAR_SORT_THRES	32768
+
+#define STATE_MASK	((1ull << (D3DUT_RQ_SHADER_BITS + D3DUT_RQ_MATERIAL_BITS + D3DUT_RQ_MESH_BITS)) - 1)
+
+static int count_state_changes(const unsigned long long *keys, size_t count);
+
+RenderQueue::RenderQueue()
+{
+	memset(&stats, 0, sizeof stats);
+}
+
+void RenderQueue::submit(unsigned long long key, D3DUT_DrawFunc func, void *cls)
+{
+	RQPacket pkt;
+	pkt.func = func;
+	pkt.cls = cls;
+
+	order.push_back((unsigned int)packets.size());
+	keys.push_back(key);
+	packets.push_back(pkt);
+}
+
+void RenderQueue::sort()
+{
+	size_t count = keys.size();
+
+	stats.num_packets = (int)count;
+	if(!count) {
+		stats.state_changes = stats.state_changes_unsorted = 0;
+		return;
+	}
+	stats.state_changes_unsorted = count_state_changes(&keys[0], count);
+
+	if(count > 1) {
+		tmp_keys.resize(count);
+		tmp_order.resize(count);
+		radix_sort(&keys[0], &order[0], count, &tmp_keys[0], &tmp_order[0], &hist);
+	}
+
+	stats.state_changes = count_state_changes(&keys[0], count);
+}
+
+void RenderQueue::replay()
+{
+	for(size_t i=0; i<order.size(); i++) {
+		RQPacket *pkt = &packets[order[i]];
+		if(pkt->func) {
+			pkt->func(pkt->cls);
+		}
+	}
+}
+
+void RenderQueue::clear()
+{
+	// clear keeps the capacity, so steady-state frames don't allocate
+	keys.clear();
+	order.clear();
+	packets.clear();
+}
+
+int RenderQueue::get_num_packets() const
+{
+	return (int)packets.size();
+}
+
+const RQStats &RenderQueue::get_stats() const
+{
+	return stats;
+}
+
+const unsigned long long *RenderQueue::get_sorted_keys() const
+{
+	return keys.empty() ? 0 : &keys[0];
+}
+
+
+static int count_state_changes(const unsigned long long *keys, size_t count)
+{
+	if(count < 1) return 0;
+
+	int changes = 1;	// the first packet always sets its state
+	unsigned long long prev = keys[0] & STATE_MASK;
+	for(size_t i=1; i<count; i++) {
+		unsigned long long st = keys[i] & STATE_MASK;
+		if(st != prev) {
+			changes++;
+			prev = st;
+		}
+	}
+	return changes;
+}
+
+
+struct SortJob {
+	const unsigned long long *src_keys;
+	const unsigned int *src_order;
+	unsigned long long *dst_keys;
+	unsigned int *dst_order;
+	size_t count, chunk_size;
+	int shift;
+	unsigned int *hist;		// RADIX_SIZE per job
+	unsigned int *hist_all;	// RADIX_PASSES * RADIX_SIZE per job
+};
+
+static void job_range(const SortJob *sj, int job, size_t *start, size_t *end)
+{
+	*start = job * sj->chunk_size;
+	*end = *start + sj->chunk_size;
+	if(*end > sj->count) *end = sj->count;
+}
+
+// histograms of all digits at once, to find out which passes can be skipped
+static void hist_all_job(int job, void *cls)
+{
+	SortJob *sj = (SortJob*)cls;
+	size_t start, end;
+	job_range(sj, job, &start, &end);
+
+	unsigned int *hist = sj->hist_all + job * RADIX_PASSES * RADIX_SIZE;
+	memset(hist, 0, RADIX_PASSES * RADIX_SIZE * sizeof *hist);
+
+	for(size_t i=start; i<end; i++) {
+		unsigned long long key = sj->src_keys[i];
+		for(int j=0; j<RADIX_PASSES; j++) {
+			hist[j * RADIX_SIZE + ((key >> (j * RADIX_BITS)) & (RADIX_SIZE - 1))]++;
+		}
+	}
+}
+
+static void hist_job(int job, void *cls)
+{
+	SortJob *sj = (SortJob*)cls;
+	size_t start, end;
+	job_range(sj, job, &start, &end);
+
+	unsigned int *hist = sj->hist + job * RADIX_SIZE;
+	memset(hist, 0, RADIX_SIZE * sizeof *hist);
+
+	for(size_t i=start; i<end; i++) {
+		hist[(sj->src_keys[i] >> sj->shift) & (RADIX_SIZE - 1)]++;
+	}
+}
+
+// hist holds the output offsets of each digit for this job at this point
+static void scatter_job(int job, void *cls)
+{
+	SortJob *sj = (SortJob*)cls;
+	size_t start, end;
+	job_range(sj, job, &start, &end);
+
+	unsigned int *offs = sj->hist + job * RADIX_SIZE;
+
+	for(size_t i=start; i<end; i++) {
+		unsigned long long key = sj->src_keys[i];
+		unsigned int idx = offs[(key >> sj->shift) & (RADIX_SIZE - 1)]++;
+		sj->dst_keys[idx] = key;
+		sj->dst_order[idx] = sj->src_order[i];
+	}
+}
+
+void radix_sort(unsigned long long *keys, unsigned int *order, size_t count,
+		unsigned long long *tmp_keys, unsigned int *tmp_order, MemVector<unsigned int, MEM_RENDER>::type *hist)
+{
+	ThreadPool *tpool = 0;
+	int njobs = 1;
+	if(count >= PAR_SORT_THRES) {
+		tpool = get_thread_pool();
+		njobs = tpool->get_num_threads();
+	}
+
+	hist->resize(njobs * (RADIX_PASSES + 1) * RADIX_SIZE);
+
+	SortJob sj;
+	sj.count = count;
+	sj.chunk_size = (count + njobs - 1) / njobs;
+	sj.hist = &(*hist)[0];
+	sj.hist_all = sj.hist + njobs * RADIX_SIZE;
+	sj.src_keys = keys;
+	sj.src_order = order;
+	sj.dst_keys = tmp_keys;
+	sj.dst_order = tmp_order;
+
+	if(tpool) {
+		tpool->run(njobs, hist_all_job, &sj);
+	} else {
+		hist_all_job(0, &sj);
+	}
+
+	for(int pass=0; pass<RADIX_PASSES; pass++) {
+		sj.shift = pass * RADIX_BITS;
+
+		// if every key has the same digit in this position, the pass is a no-op
+		bool trivial = false;
+		for(int i=0; i<RADIX_SIZE; i++) {
+			unsigned int total = 0;
+			for(int j=0; j<njobs; j++) {
+				total += sj.hist_all[(j * RADIX_PASSES + pass) * RADIX_SIZE + i];
+			}
+			if(total == count) {
+				trivial = true;
+				break;
+			}
+			if(total) break;
+		}
+		if(trivial) continue;
+
+		if(pass > 0) {
+			if(tpool) {
+				tpool->run(njobs, hist_job, &sj);
+			} else {
+				hist_job(0, &sj);
+			}
+		} else {
+			// first pass: the source order is still the original, reuse hist_all
+			for(int j=0; j<njobs; j++) {
+				memcpy(sj.hist + j * RADIX_SIZE, sj.hist_all + j * RADIX_PASSES * RADIX_SIZE,
+						RADIX_SIZE * sizeof *sj.hist);
+			}
+		}
+
+		// turn the per-job counts into per-job output offsets (digit-major)
+		unsigned int offs = 0;
+		for(int i=0; i<RADIX_SIZE; i++) {
+			for(int j=0; j<njobs; j++) {
+				unsigned int *hptr = sj.hist + j * RADIX_SIZE + i;
+				unsigned int cnt = *hptr;
+				*hptr = offs;
+				offs += cnt;
+			}
+		}
+
+		if(tpool) {
+			tpool->run(njobs, scatter_job, &sj);
+		} else {
+			scatter_job(0, &sj);
+		}
+
+		// swap source and destination for the next pass
+		const unsigned long long *kptr = sj.src_keys;
+		const unsigned int *optr = sj.src_order;
+		sj.src_keys = sj.dst_keys;
+		sj.src_order = sj.dst_order;
+		sj.dst_keys = (unsigned long long*)kptr;
+		sj.dst_order = (unsigned int*)optr;
+	}
+
+	if(sj.src_keys != keys) {
+		memcpy(keys, sj.src_keys, count * sizeof *keys);
+		memcpy(order, sj.src_order, count * sizeof *order);
+	}
+}
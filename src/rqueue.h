@@ -0,0 +1,63 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_RQUEUE_H_
+#define D3DUT_RQUEUE_H_
+
+#include "d3dut.h"
+#include "alloc.h"
+
+struct RQPacket {
+	D3DUT_DrawFunc func;
+	void *cls;
+};
+
+struct RQStats {
+	int num_packets;
+	int state_changes;			// state changes in the sorted order
+	int state_changes_unsorted;	// state changes in submission order
+};
+
+class RenderQueue {
+private:
+	MemVector<unsigned long long, MEM_RENDER>::type keys, tmp_keys;
+	MemVector<unsigned int, MEM_RENDER>::type order, tmp_order;
+	MemVector<RQPacket, MEM_RENDER>::type packets;
+	MemVector<unsigned int, MEM_RENDER>::type hist;	// per-job radix histograms
+
+	RQStats stats;
+
+public:
+	RenderQueue();
+
+	void submit(unsigned long long key, D3DUT_DrawFunc func, void *cls);
+
+	void sort();
+	void replay();
+	void clear();
+
+	int get_num_packets() const;
+	const RQStats &get_stats() const;
+
+	const unsigned long long *get_sorted_keys() const;
+};
+
+// sorts keys in place, permuting order along with them
+void radix_sort(unsigned long long *keys, unsigned int *order, size_t count,
+		unsigned long long *tmp_keys, unsigned int *tmp_order, MemVector<unsigned int, MEM_RENDER>::type *hist);
+
+#endif	// D3DUT_RQUEUE_H_
@@ -0,0 +1,79 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "simd.h"
+
+enum {
+	CPU_AVX = 1,
+	CPU_AVX2 = 2,
+	CPU_VALID = 0x80
+};
+
+static int cpu_features;
+static bool avx_disabled;
+
+static int detect_features()
+{
+	int res = CPU_VALID;
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int max_leaf = info[0];
+
+	__cpuid(info, 1);
+	// OSXSAVE and AVX, and the OS saves both xmm and ymm state
+	if((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6) {
+		res |= CPU_AVX;
+
+		if(max_leaf >= 7) {
+			__cpuidex(info, 7, 0);
+			if(info[1] & (1 << 5)) {
+				res |= CPU_AVX2;
+			}
+		}
+	}
+#else
+	if(__builtin_cpu_supports("avx")) res |= CPU_AVX;
+	if(__builtin_cpu_supports("avx2")) res |= CPU_AVX2;
+#endif
+	return res;
+}
+
+// the detection is idempotent, so racing first calls are harmless
+bool cpu_has_avx()
+{
+	if(!cpu_features) {
+		cpu_features = detect_features();
+	}
+	return !avx_disabled && (cpu_features & CPU_AVX) != 0;
+}
+
+bool cpu_has_avx2()
+{
+	if(!cpu_features) {
+		cpu_features = detect_features();
+	}
+	return !avx_disabled && (cpu_features & CPU_AVX2) != 0;
+}
+
+void cpu_disable_avx(bool disable)
+{
+	avx_disabled = disable;
+}
@@ -0,0 +1,42 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_SIMD_H_
+#define D3DUT_SIMD_H_
+
+/* functions using AVX/AVX2 intrinsics are compiled with these attributes
+ * (needed by gcc, msvc allows them anywhere), and must only be called after
+ * checking for support at runtime.
+ */
+#ifdef __GNUC__
+#define TARGET_AVX	__attribute__((target("avx")))
+#define TARGET_AVX2	__attribute__((target("avx2")))
+#else
+#define TARGET_AVX
+#define TARGET_AVX2
+#endif
+
+// instruction set support, including OS support for saving the ymm registers
+bool cpu_has_avx();
+bool cpu_has_avx2();
+
+/* makes both of the above return false, so the SSE paths can be tested on
+ * machines with AVX. Modules which check once, on first use, keep what they saw.
+ */
+void cpu_disable_avx(bool disable);
+
+#endif	// D3DUT_SIMD_H_
@@ -0,0 +1,198 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include "statecache.h"
+
+StateCache::StateCache()
+{
+	ctx = 0;
+	num_issued = num_skipped = 0;
+	invalidate();
+}
+
+void StateCache::set_context(ID3D11DeviceContext *ctx)
+{
+	this->ctx = ctx;
+	invalidate();
+}
+
+ID3D11DeviceContext *StateCache::get_context() const
+{
+	return ctx;
+}
+
+void StateCache::invalidate()
+{
+	memset(vbuf, 0, sizeof vbuf);
+	memset(vbuf_stride, 0, sizeof vbuf_stride);
+	memset(vbuf_offs, 0, sizeof vbuf_offs);
+	memset(vs_cbuf, 0, sizeof vs_cbuf);
+	memset(ps_cbuf, 0, sizeof ps_cbuf);
+	layout = 0;
+	topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	vsdr = 0;
+	psdr = 0;
+
+	vbuf_valid = vs_cbuf_valid = ps_cbuf_valid = 0;
+	layout_valid = topology_valid = vsdr_valid = psdr_valid = false;
+}
+
+void StateCache::set_vertex_buffers(unsigned int start, unsigned int count, ID3D11Buffer *const *bufs,
+		const unsigned int *strides, const unsigned int *offsets)
+{
+	if(start + count > SC_MAX_VBUFS) {
+		// out of range, let the runtime deal with it
+		ctx->IASetVertexBuffers(start, count, bufs, strides, offsets);
+		num_issued++;
+		return;
+	}
+
+	// find the smallest sub-range of slots which actually differ
+	int first = -1, last = -1;
+	for(unsigned int i=0; i<count; i++) {
+		unsigned int slot = start + i;
+		if(!(vbuf_valid & (1 << slot)) || vbuf[slot] != bufs[i] ||
+				vbuf_stride[slot] != strides[i] || vbuf_offs[slot] != offsets[i]) {
+			if(first == -1) first = i;
+			last = i;
+		}
+	}
+
+	if(first == -1) {
+		num_skipped++;
+		return;
+	}
+
+	for(int i=first; i<=last; i++) {
+		unsigned int slot = start + i;
+		vbuf[slot] = bufs[i];
+		vbuf_stride[slot] = strides[i];
+		vbuf_offs[slot] = offsets[i];
+		vbuf_valid |= 1 << slot;
+	}
+	ctx->IASetVertexBuffers(start + first, last - first + 1, bufs + first, strides + first, offsets + first);
+	num_issued++;
+}
+
+void StateCache::set_input_layout(ID3D11InputLayout *layout)
+{
+	if(layout_valid && this->layout == layout) {
+		num_skipped++;
+		return;
+	}
+	this->layout = layout;
+	layout_valid = true;
+	ctx->IASetInputLayout(layout);
+	num_issued++;
+}
+
+void StateCache::set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY top)
+{
+	if(topology_valid && topology == top) {
+		num_skipped++;
+		return;
+	}
+	topology = top;
+	topology_valid = true;
+	ctx->IASetPrimitiveTopology(top);
+	num_issued++;
+}
+
+void StateCache::set_vertex_shader(ID3D11VertexShader *sdr)
+{
+	if(vsdr_valid && vsdr == sdr) {
+		num_skipped++;
+		return;
+	}
+	vsdr = sdr;
+	vsdr_valid = true;
+	ctx->VSSetShader(sdr, 0, 0);
+	num_issued++;
+}
+
+void StateCache::set_pixel_shader(ID3D11PixelShader *sdr)
+{
+	if(psdr_valid && psdr == sdr) {
+		num_skipped++;
+		return;
+	}
+	psdr = sdr;
+	psdr_valid = true;
+	ctx->PSSetShader(sdr, 0, 0);
+	num_issued++;
+}
+
+void StateCache::set_vs_constant_buffers(unsigned int start, unsigned int count, ID3D11Buffer *const *bufs)
+{
+	set_cbufs(vs_cbuf, &vs_cbuf_valid, start, count, bufs, true);
+}
+
+void StateCache::set_ps_constant_buffers(unsigned int start, unsigned int count, ID3D11Buffer *const *bufs)
+{
+	set_cbufs(ps_cbuf, &ps_cbuf_valid, start, count, bufs, false);
+}
+
+void StateCache::set_cbufs(ID3D11Buffer **cache, unsigned int *valid, unsigned int start,
+		unsigned int count, ID3D11Buffer *const *bufs, bool vs)
+{
+	int first = -1, last = -1;
+
+	if(start + count > SC_MAX_CBUFS) {
+		first = 0;
+		last = (int)count - 1;
+	} else {
+		for(unsigned int i=0; i<count; i++) {
+			unsigned int slot = start + i;
+			if(!(*valid & (1 << slot)) || cache[slot] != bufs[i]) {
+				if(first == -1) first = i;
+				last = i;
+			}
+		}
+		if(first == -1) {
+			num_skipped++;
+			return;
+		}
+
+		for(int i=first; i<=last; i++) {
+			cache[start + i] = bufs[i];
+			*valid |= 1 << (start + i);
+		}
+	}
+
+	if(vs) {
+		ctx->VSSetConstantBuffers(start + first, last - first + 1, bufs + first);
+	} else {
+		ctx->PSSetConstantBuffers(start + first, last - first + 1, bufs + first);
+	}
+	num_issued++;
+}
+
+unsigned long StateCache::get_issued() const
+{
+	return num_issued;
+}
+
+unsigned long StateCache::get_skipped() const
+{
+	return num_skipped;
+}
+
+void StateCache::reset_counters()
+{
+	num_issued = num_skipped = 0;
+}
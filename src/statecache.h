@@ -0,0 +1,76 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_STATECACHE_H_
+#define D3DUT_STATECACHE_H_
+
+#include <d3d11.h>
+
+#define SC_MAX_VBUFS	D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT
+#define SC_MAX_CBUFS	D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT
+
+/* Shadows the pipeline state bound through it, and forwards only the calls
+ * which actually change something to the underlying context. Any state set
+ * directly on the context behind its back must be followed by invalidate().
+ * The context is only ever accessed through its virtual interface, so it can
+ * be pointed to any ID3D11DeviceContext implementation (e.g. a call-recording
+ * mock) with set_context.
+ */
+class StateCache {
+private:
+	ID3D11DeviceContext *ctx;
+
+	ID3D11Buffer *vbuf[SC_MAX_VBUFS];
+	unsigned int vbuf_stride[SC_MAX_VBUFS], vbuf_offs[SC_MAX_VBUFS];
+	ID3D11InputLayout *layout;
+	D3D11_PRIMITIVE_TOPOLOGY topology;
+	ID3D11VertexShader *vsdr;
+	ID3D11PixelShader *psdr;
+	ID3D11Buffer *vs_cbuf[SC_MAX_CBUFS], *ps_cbuf[SC_MAX_CBUFS];
+
+	// bitmasks of which of the shadowed values above are known to be current
+	unsigned int vbuf_valid, vs_cbuf_valid, ps_cbuf_valid;
+	bool layout_valid, topology_valid, vsdr_valid, psdr_valid;
+
+	unsigned long num_issued, num_skipped;
+
+	void set_cbufs(ID3D11Buffer **cache, unsigned int *valid, unsigned int start,
+			unsigned int count, ID3D11Buffer *const *bufs, bool vs);
+
+public:
+	StateCache();
+
+	void set_context(ID3D11DeviceContext *ctx);
+	ID3D11DeviceContext *get_context() const;
+
+	void invalidate();
+
+	void set_vertex_buffers(unsigned int start, unsigned int count, ID3D11Buffer *const *bufs,
+			const unsigned int *strides, const unsigned int *offsets);
+	void set_input_layout(ID3D11InputLayout *layout);
+	void set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY top);
+	void set_vertex_shader(ID3D11VertexShader *sdr);
+	void set_pixel_shader(ID3D11PixelShader *sdr);
+	void set_vs_constant_buffers(unsigned int start, unsigned int count, ID3D11Buffer *const *bufs);
+	void set_ps_constant_buffers(unsigned int start, unsigned int count, ID3D11Buffer *const *bufs);
+
+	unsigned long get_issued() const;
+	unsigned long get_skipped() const;
+	void reset_counters();
+};
+
+#endif	// D3DUT_STATECACHE_H_
@@ -0,0 +1,126 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include "texture.h"
+#include "mipmap.h"
+#include "bcenc.h"
+#include "logmsg.h"
+
+static int bc_format(unsigned int flags)
+{
+	if(flags & D3DUT_TEX_BC1) return BCFMT_BC1;
+	if(flags & D3DUT_TEX_BC3) return BCFMT_BC3;
+	if(flags & D3DUT_TEX_BC5) return BCFMT_BC5;
+	return -1;
+}
+
+static DXGI_FORMAT texture_format(int bcfmt, bool srgb)
+{
+	switch(bcfmt) {
+	case BCFMT_BC1:
+		return srgb ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+	case BCFMT_BC3:
+		return srgb ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+	case BCFMT_BC5:
+		return DXGI_FORMAT_BC5_UNORM;	// no sRGB variant
+	default:
+		break;
+	}
+	return srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+}
+
+ID3D11ShaderResourceView *create_texture(int xsz, int ysz, const unsigned char *pixels,
+		int filter, unsigned int flags, float alpha_ref)
+{
+	bool srgb = (flags & D3DUT_TEX_SRGB) != 0;
+	int bcfmt = bc_format(flags);
+
+	if(bcfmt >= 0 && ((xsz & 3) || (ysz & 3))) {
+		warning("create_texture: block compressed texture size must be a multiple of 4 (%dx%d)\n", xsz, ysz);
+		return 0;
+	}
+
+	D3D11_SUBRESOURCE_DATA subdata[MAX_MIP_LEVELS];
+	memset(subdata, 0, sizeof subdata);
+
+	MipChain chain;
+	int num_levels = 1;
+	int width[MAX_MIP_LEVELS], height[MAX_MIP_LEVELS];
+	if(flags & D3DUT_TEX_NO_MIPMAPS) {
+		width[0] = xsz;
+		height[0] = ysz;
+		subdata[0].pSysMem = pixels;
+		subdata[0].SysMemPitch = xsz * 4;
+	} else {
+		if(!gen_mipmaps(&chain, xsz, ysz, pixels, filter, srgb, alpha_ref)) {
+			return 0;
+		}
+		num_levels = chain.num_levels;
+		for(int i=0; i<num_levels; i++) {
+			width[i] = chain.width[i];
+			height[i] = chain.height[i];
+			subdata[i].pSysMem = &chain.pixels[chain.offset[i]];
+			subdata[i].SysMemPitch = width[i] * 4;
+		}
+	}
+
+	// compress each level, replacing the RGBA8 pixels in subdata
+	MemVector<unsigned char, MEM_TEXTURES>::type bcdata;
+	if(bcfmt >= 0) {
+		size_t offset[MAX_MIP_LEVELS], total = 0;
+		for(int i=0; i<num_levels; i++) {
+			offset[i] = total;
+			total += bc_size(bcfmt, width[i], height[i]);
+		}
+		bcdata.resize(total);
+
+		for(int i=0; i<num_levels; i++) {
+			bc_encode(bcfmt, (flags & D3DUT_TEX_BC_QUALITY) != 0, width[i], height[i],
+					(const unsigned char*)subdata[i].pSysMem, &bcdata[offset[i]]);
+
+			subdata[i].pSysMem = &bcdata[offset[i]];
+			subdata[i].SysMemPitch = (UINT)bc_size(bcfmt, width[i], 1);
+		}
+	}
+
+	D3D11_TEXTURE2D_DESC desc;
+	memset(&desc, 0, sizeof desc);
+	desc.Width = xsz;
+	desc.Height = ysz;
+	desc.MipLevels = num_levels;
+	desc.ArraySize = 1;
+	desc.Format = texture_format(bcfmt, srgb);
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	ID3D11Texture2D *tex;
+	if(d3dut_dev->CreateTexture2D(&desc, subdata, &tex) != 0) {
+		warning("failed to create %dx%d texture\n", xsz, ysz);
+		return 0;
+	}
+
+	ID3D11ShaderResourceView *view;
+	if(d3dut_dev->CreateShaderResourceView(tex, 0, &view) != 0) {
+		warning("failed to create texture shader resource view\n");
+		tex->Release();
+		return 0;
+	}
+	tex->Release();	// the view holds a reference to it
+	return view;
+}
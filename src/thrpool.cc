@@ -0,0 +1,167 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "thrpool.h"
+
+static ThreadPool *pool;
+
+ThreadPool::ThreadPool(int nthreads)
+{
+	if(nthreads <= 0) {
+		nthreads = std::thread::hardware_concurrency();
+		if(nthreads <= 0) nthreads = 1;
+	}
+
+	func = 0;
+	cls = 0;
+	num_jobs = next_job = jobs_done = 0;
+	quit = false;
+
+	// the calling thread counts as one of the workers
+	for(int i=0; i<nthreads - 1; i++) {
+		threads.push_back(std::thread(&ThreadPool::thread_func, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	work_cond.notify_all();
+
+	for(size_t i=0; i<threads.size(); i++) {
+		threads[i].join();
+	}
+}
+
+void ThreadPool::detach()
+{
+	/* don't touch the mutex or condition variables, the workers may have been
+	 * terminated while holding them. They are left blocked waiting for work.
+	 */
+	for(size_t i=0; i<threads.size(); i++) {
+		threads[i].detach();
+	}
+	threads.clear();
+}
+
+int ThreadPool::get_num_threads() const
+{
+	return (int)threads.size() + 1;
+}
+
+void ThreadPool::run(int njobs, ThreadJobFunc func, void *cls)
+{
+	if(njobs <= 0) return;
+
+	if(threads.empty() || njobs == 1) {
+		for(int i=0; i<njobs; i++) {
+			func(i, cls);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> run_lock(run_mutex);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->func = func;
+		this->cls = cls;
+		num_jobs = njobs;
+		next_job = jobs_done = 0;
+	}
+	work_cond.notify_all();
+
+	while(do_job());
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while(jobs_done < num_jobs) {
+		done_cond.wait(lock);
+	}
+	num_jobs = 0;
+}
+
+bool ThreadPool::do_job()
+{
+	int job;
+	ThreadJobFunc jfunc;
+	void *jcls;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(next_job >= num_jobs) {
+			return false;
+		}
+		job = next_job++;
+		jfunc = func;
+		jcls = cls;
+	}
+
+	jfunc(job, jcls);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if(++jobs_done >= num_jobs) {
+		done_cond.notify_all();
+	}
+	return true;
+}
+
+void ThreadPool::thread_func()
+{
+	for(;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while(!quit && next_job >= num_jobs) {
+				work_cond.wait(lock);
+			}
+			if(quit) return;
+		}
+		while(do_job());
+	}
+}
+
+ThreadPool *get_thread_pool()
+{
+	if(!pool) {
+		pool = mem_new<ThreadPool>(MEM_MISC);
+	}
+	return pool;
+}
+
+void init_thread_pool(int nthreads)
+{
+	destroy_thread_pool();
+
+	void *ptr = mem_alloc(sizeof(ThreadPool), MEM_MISC, ALIGNOF(ThreadPool));
+	pool = new(ptr) ThreadPool(nthreads);
+}
+
+void destroy_thread_pool()
+{
+	mem_delete(pool);
+	pool = 0;
+}
+
+void detach_thread_pool()
+{
+	if(pool) {
+		// leaked on purpose, detached workers might still refer to it
+		pool->detach();
+		pool = 0;
+	}
+}
@@ -0,0 +1,71 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_THRPOOL_H_
+#define D3DUT_THRPOOL_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "alloc.h"
+
+typedef void (*ThreadJobFunc)(int job, void *cls);
+
+/* Persistent pool of worker threads for splitting CPU-heavy internal work
+ * into independent jobs. run() blocks until all jobs are done, and the
+ * calling thread works on jobs too. Jobs must not call run() recursively.
+ */
+class ThreadPool {
+private:
+	MemVector<std::thread, MEM_MISC>::type threads;
+	std::mutex run_mutex;	// serializes concurrent run() calls
+
+	std::mutex mutex;
+	std::condition_variable work_cond, done_cond;
+	ThreadJobFunc func;
+	void *cls;
+	int num_jobs, next_job, jobs_done;
+	bool quit;
+
+	void thread_func();
+	bool do_job();
+
+public:
+	explicit ThreadPool(int nthreads = 0);
+	~ThreadPool();
+
+	int get_num_threads() const;	// including the calling thread
+
+	void run(int njobs, ThreadJobFunc func, void *cls);
+
+	// let go of the worker threads without waiting for them
+	void detach();
+};
+
+// lazily created pool shared by all of d3dut
+ThreadPool *get_thread_pool();
+// (re)creates the shared pool with a specific number of threads, 0 for one per CPU
+void init_thread_pool(int nthreads);
+/* destroy_thread_pool joins the workers, so it must be called from an explicit
+ * shutdown path. At process exit (atexit handlers, DLL detach) the loader lock
+ * is held and the workers may already be gone, so detach_thread_pool just
+ * abandons them there.
+ */
+void destroy_thread_pool();
+void detach_thread_pool();
+
+#endif	// D3DUT_THRPOOL_H_
@@ -0,0 +1,173 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include <windows.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include "timestats.h"
+
+static double nsec_per_tick;
+
+static inline int msb64(unsigned long long x)
+{
+#ifdef _MSC_VER
+	unsigned long idx;
+	if(_BitScanReverse(&idx, (unsigned long)(x >> 32))) {
+		return (int)idx + 32;
+	}
+	_BitScanReverse(&idx, (unsigned long)x);
+	return (int)idx;
+#else
+	return 63 - __builtin_clzll(x);
+#endif
+}
+
+static inline int bin_index(unsigned long long x)
+{
+	if(x < HIST_SUB) {
+		return (int)x;
+	}
+	int shift = msb64(x) - HIST_SUB_BITS;
+	int idx = (shift + 1) * HIST_SUB + (int)((x >> shift) & (HIST_SUB - 1));
+	return idx < HIST_BINS ? idx : HIST_BINS - 1;
+}
+
+// smallest value falling into a bin, and the width of the bin
+static void bin_range(int idx, double *start, double *width)
+{
+	if(idx < HIST_SUB) {
+		*start = idx;
+		*width = 1;
+		return;
+	}
+	int shift = idx / HIST_SUB - 1;
+	int sub = idx % HIST_SUB;
+	*width = (double)(1ull << shift);
+	*start = (HIST_SUB + sub) * *width;
+}
+
+TimeHistogram::TimeHistogram()
+{
+	budget = 0;
+	reset();
+}
+
+void TimeHistogram::reset()
+{
+	for(int i=0; i<HIST_BINS; i++) {
+		bins[i].store(0, std::memory_order_relaxed);
+	}
+	over_budget.store(0, std::memory_order_relaxed);
+}
+
+void TimeHistogram::set_budget(unsigned long long nsec)
+{
+	budget = nsec;
+}
+
+void TimeHistogram::record(unsigned long long nsec)
+{
+	/* single writer: a plain load and store instead of an interlocked
+	 * increment keeps this down to a couple of nanoseconds.
+	 */
+	std::atomic<unsigned int> *bin = bins + bin_index(nsec);
+	bin->store(bin->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+	if(budget && nsec > budget) {
+		over_budget.store(over_budget.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+}
+
+void TimeHistogram::get_stats(D3DUT_TimeStats *stats) const
+{
+	unsigned int counts[HIST_BINS];
+	unsigned long long total = 0;
+	double sum = 0.0;
+	int max_bin = -1;
+
+	// snapshot the bins first, so that the stats below are consistent
+	for(int i=0; i<HIST_BINS; i++) {
+		counts[i] = bins[i].load(std::memory_order_relaxed);
+		if(counts[i]) {
+			double start, width;
+			bin_range(i, &start, &width);
+			sum += counts[i] * (start + width * 0.5);
+			total += counts[i];
+			max_bin = i;
+		}
+	}
+
+	memset(stats, 0, sizeof *stats);
+	stats->count = (unsigned long)total;
+	if(!total) return;
+
+	stats->mean = sum / (double)total * 1e-6;
+
+	double start, width;
+	bin_range(max_bin, &start, &width);
+	stats->max = (start + width) * 1e-6;
+
+	unsigned long long p50_count = (total + 1) / 2;
+	unsigned long long p99_count = total - total / 100;
+	unsigned long long cumul = 0;
+	bool have_p50 = false;
+	for(int i=0; i<=max_bin; i++) {
+		cumul += counts[i];
+		if(!have_p50 && cumul >= p50_count) {
+			bin_range(i, &start, &width);
+			stats->p50 = (start + width * 0.5) * 1e-6;
+			have_p50 = true;
+		}
+		if(cumul >= p99_count) {
+			bin_range(i, &start, &width);
+			stats->p99 = (start + width * 0.5) * 1e-6;
+			break;
+		}
+	}
+}
+
+unsigned int TimeHistogram::get_over_budget() const
+{
+	return over_budget.load(std::memory_order_relaxed);
+}
+
+
+void init_timer()
+{
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	nsec_per_tick = 1e9 / (double)freq.QuadPart;
+}
+
+long long get_timer_ticks()
+{
+	LARGE_INTEGER count;
+	QueryPerformanceCounter(&count);
+	return count.QuadPart;
+}
+
+unsigned long long ticks_to_nsec(long long ticks)
+{
+	return ticks > 0 ? (unsigned long long)(ticks * nsec_per_tick) : 0;
+}
+
+long long nsec_to_ticks(unsigned long long nsec)
+{
+	return (long long)(nsec / nsec_per_tick);
+}
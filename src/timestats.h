@@ -0,0 +1,57 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef D3DUT_TIMESTATS_H_
+#define D3DUT_TIMESTATS_H_
+
+#include <atomic>
+#include "d3dut.h"
+
+#define HIST_SUB_BITS	4
+#define HIST_SUB		(1 << HIST_SUB_BITS)
+#define HIST_GROUPS		40	// covers up to 2^43 ns (about 2.4 hours)
+#define HIST_BINS		(HIST_GROUPS * HIST_SUB)
+
+/* Log-linear (HDR-style) histogram of nanosecond durations, with 16 linear
+ * sub-bins per power of two, for a relative error of about 3%.
+ * There must only be a single thread calling record(), but the stats can be
+ * read from any thread at any time without locking.
+ */
+class TimeHistogram {
+private:
+	std::atomic<unsigned int> bins[HIST_BINS];
+	std::atomic<unsigned int> over_budget;
+	unsigned long long budget;
+
+public:
+	TimeHistogram();
+
+	void reset();
+	void set_budget(unsigned long long nsec);
+
+	void record(unsigned long long nsec);
+
+	void get_stats(D3DUT_TimeStats *stats) const;
+	unsigned int get_over_budget() const;
+};
+
+void init_timer();
+long long get_timer_ticks();
+unsigned long long ticks_to_nsec(long long ticks);
+long long nsec_to_ticks(unsigned long long nsec);
+
+#endif	// D3DUT_TIMESTATS_H_
@@ -20,9 +20,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "win.h"
 #include "logmsg.h"
 
-std::vector<Window*> windows;
+WindowList windows;
 int active_win = -1;
 
+D3DUT_LoopHookFunc loop_hook;
+void *loop_hook_cls;
+
 int create_window(const char *title, int xsz, int ysz, unsigned int dmflags)
 {
 	IDXGIDevice *dxgidev;
@@ -43,7 +46,7 @@ int create_window(const char *title, int xsz, int ysz, unsigned int dmflags)
 	adapter->Release();
 	dxgidev->Release();
 
-	Window *win = new Window;
+	Window *win = mem_new<Window>(MEM_WINDOWS);
 	memset(win, 0, sizeof *win);
 	win->must_redisplay = true;
 	win->changed_size = true;
@@ -102,8 +105,17 @@ int create_window(const char *title, int xsz, int ysz, unsigned int dmflags)
 	rtex->Release();
 	d3dut_ctx->OMSetRenderTargets(1, &win->rtarg_view, 0);
 
-	int idx = (int)windows.size();
-	windows.push_back(win);
+	win->latency = mem_new<InputLatency>(MEM_EVENTS);
+
+	int idx = 0;
+	while(idx < (int)windows.size() && windows[idx]) {
+		idx++;
+	}
+	if(idx < (int)windows.size()) {
+		windows[idx] = win;
+	} else {
+		windows.push_back(win);
+	}
 	set_active_win(idx);
 	return idx;
 }
@@ -120,14 +132,15 @@ void destroy_window(int idx)
 		DestroyWindow(win->win);
 		win->rtarg_view->Release();
 		win->swap->Release();
-		delete win;
+		mem_delete(win->latency);
+		mem_delete(win);
 		windows[idx] = 0;
 	}
 }
 
 void set_active_win(int idx)
 {
-	if(idx < 0 || idx >= (int)windows.size()) {
+	if(idx < 0 || idx >= (int)windows.size() || !windows[idx]) {
 		warning("set_active_win: invalid window: %d\n", idx);
 		return;
 	}
@@ -154,7 +167,7 @@ Window *get_window(int idx)
 static int find_window(HWND syswin)
 {
 	for(size_t i=0; i<windows.size(); i++) {
-		if(windows[i]->win == syswin) {
+		if(windows[i] && windows[i]->win == syswin) {
 			return i;
 		}
 	}
@@ -172,6 +185,31 @@ static int count_windows()
 	return count;
 }
 
+static int input_type(unsigned int msg)
+{
+	switch(msg) {
+	case WM_KEYDOWN:
+	case WM_KEYUP:
+		return INPUT_KEYBOARD;
+
+	case WM_LBUTTONDOWN:
+	case WM_RBUTTONDOWN:
+	case WM_MBUTTONDOWN:
+	case WM_LBUTTONUP:
+	case WM_RBUTTONUP:
+	case WM_MBUTTONUP:
+	case WM_MOUSEWHEEL:
+		return INPUT_MOUSE_BUTTON;
+
+	case WM_MOUSEMOVE:
+		return INPUT_MOUSE_MOTION;
+
+	default:
+		break;
+	}
+	return -1;
+}
+
 static void mouse_handler(Window *win, int bn, bool pressed);
 
 long CALLBACK win_handle_event(HWND syswin, unsigned int msg, unsigned int wparam, long lparam)
@@ -181,6 +219,11 @@ long CALLBACK win_handle_event(HWND syswin, unsigned int msg, unsigned int wpara
 	if(winid != -1) {
 		set_active_win(winid);
 		win = get_window();
+
+		int type = input_type(msg);
+		if(type != -1) {
+			win->latency->input_event(type, input_arrival_time());
+		}
 	}
 
 	switch(msg) {
@@ -203,6 +246,9 @@ long CALLBACK win_handle_event(HWND syswin, unsigned int msg, unsigned int wpara
 		break;
 
 	case WM_KEYDOWN:
+		if(loop_hook) {
+			loop_hook(D3DUT_HOOK_KEY, wparam, loop_hook_cls);
+		}
 		if(wparam < 256) {
 			if(win->keyboard_func) {
 				win->keyboard_func(wparam, win->mousex, win->mousey);
@@ -18,8 +18,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef D3DUT_WIN_H_
 #define D3DUT_WIN_H_
 
-#include <vector>
 #include <d3d11.h>
+#include "alloc.h"
+#include "latency.h"
 
 #define WINCLASSNAME	"d3dutwindow"
 
@@ -33,6 +34,8 @@ struct Window {
 	bool must_redisplay, changed_size;
 	int mousex, mousey;
 
+	InputLatency *latency;
+
 	D3DUT_DisplayFunc display_func;
 	D3DUT_ReshapeFunc reshape_func;
 	D3DUT_KeyboardFunc keyboard_func;
@@ -44,7 +47,13 @@ struct Window {
 	D3DUT_PassiveMotionFunc passive_motion_func;
 };
 
-extern std::vector<Window*> windows;
+typedef MemVector<Window*, MEM_WINDOWS>::type WindowList;
+
+// closed windows leave a null entry, which is reused by the next new window
+extern WindowList windows;
+
+extern D3DUT_LoopHookFunc loop_hook;
+extern void *loop_hook_cls;
 
 int create_window(const char *title, int xsz, int ysz, unsigned int dmflags);
 void destroy_window(int idx);
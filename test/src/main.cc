@@ -0,0 +1,83 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* test - runs the d3dut unit tests which don't need a GPU or a window.
+ * usage: test [test name]...
+ * With no arguments all tests are run. Exits with a non-zero status if any
+ * check fails.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "test.h"
+
+int test_failures;
+
+void test_statecache();
+void test_bcenc();
+void test_cull();
+
+static struct {
+	const char *name;
+	void (*func)();
+} tests[] = {
+	{"statecache", test_statecache},
+	{"bcenc", test_bcenc},
+	{"cull", test_cull},
+	{0, 0}
+};
+
+static bool run_test(int idx)
+{
+	int prev_failures = test_failures;
+	tests[idx].func();
+
+	bool pass = test_failures == prev_failures;
+	printf("%-12s %s\n", tests[idx].name, pass ? "ok" : "FAILED");
+	return pass;
+}
+
+int main(int argc, char **argv)
+{
+	int num_failed = 0;
+
+	if(argc <= 1) {
+		for(int i=0; tests[i].name; i++) {
+			if(!run_test(i)) num_failed++;
+		}
+	} else {
+		for(int i=1; i<argc; i++) {
+			int idx = -1;
+			for(int j=0; tests[j].name; j++) {
+				if(strcmp(tests[j].name, argv[i]) == 0) {
+					idx = j;
+					break;
+				}
+			}
+			if(idx == -1) {
+				fprintf(stderr, "unknown test: %s\n", argv[i]);
+				return 1;
+			}
+			if(!run_test(idx)) num_failed++;
+		}
+	}
+
+	if(num_failed) {
+		printf("%d test(s) failed\n", num_failed);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,225 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef MOCKCTX_H_
+#define MOCKCTX_H_
+
+#include <vector>
+#include <d3d11.h>
+
+enum {
+	MOCK_IA_VBUFS,
+	MOCK_IA_LAYOUT,
+	MOCK_IA_TOPOLOGY,
+	MOCK_VS_SHADER,
+	MOCK_PS_SHADER,
+	MOCK_VS_CBUFS,
+	MOCK_PS_CBUFS
+};
+
+struct MockCall {
+	int func;
+	unsigned int start, count;
+	std::vector<const void*> obj;	// bound objects, one per slot
+	std::vector<unsigned int> stride, offset;
+	unsigned int value;				// topology
+};
+
+/* fake device context which records the state setting calls used by the
+ * state cache. Anything else just counts as an unexpected call.
+ */
+class MockContext : public ID3D11DeviceContext {
+public:
+	std::vector<MockCall> calls;
+	int other_calls;
+
+	MockContext() : other_calls(0) {}
+
+	void clear() { calls.clear(); other_calls = 0; }
+
+	MockCall *add_call(int func, UINT start, UINT count)
+	{
+		MockCall call;
+		call.func = func;
+		call.start = start;
+		call.count = count;
+		call.value = 0;
+		calls.push_back(call);
+		return &calls.back();
+	}
+
+	template <typename T>
+	void add_slots(int func, UINT start, UINT count, T *const *objs)
+	{
+		MockCall *call = add_call(func, start, count);
+		for(UINT i=0; i<count; i++) {
+			call->obj.push_back(objs[i]);
+		}
+	}
+
+	// recorded calls
+	void STDMETHODCALLTYPE IASetVertexBuffers(UINT start, UINT count, ID3D11Buffer *const *bufs,
+			const UINT *strides, const UINT *offsets)
+	{
+		add_slots(MOCK_IA_VBUFS, start, count, bufs);
+		for(UINT i=0; i<count; i++) {
+			calls.back().stride.push_back(strides[i]);
+			calls.back().offset.push_back(offsets[i]);
+		}
+	}
+	void STDMETHODCALLTYPE IASetInputLayout(ID3D11InputLayout *layout)
+	{
+		add_slots(MOCK_IA_LAYOUT, 0, 1, &layout);
+	}
+	void STDMETHODCALLTYPE IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY top)
+	{
+		add_call(MOCK_IA_TOPOLOGY, 0, 1)->value = top;
+	}
+	void STDMETHODCALLTYPE VSSetShader(ID3D11VertexShader *sdr, ID3D11ClassInstance *const *inst, UINT ninst)
+	{
+		add_slots(MOCK_VS_SHADER, 0, 1, &sdr);
+	}
+	void STDMETHODCALLTYPE PSSetShader(ID3D11PixelShader *sdr, ID3D11ClassInstance *const *inst, UINT ninst)
+	{
+		add_slots(MOCK_PS_SHADER, 0, 1, &sdr);
+	}
+	void STDMETHODCALLTYPE VSSetConstantBuffers(UINT start, UINT count, ID3D11Buffer *const *bufs)
+	{
+		add_slots(MOCK_VS_CBUFS, start, count, bufs);
+	}
+	void STDMETHODCALLTYPE PSSetConstantBuffers(UINT start, UINT count, ID3D11Buffer *const *bufs)
+	{
+		add_slots(MOCK_PS_CBUFS, start, count, bufs);
+	}
+
+	// IUnknown and ID3D11DeviceChild
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **obj) { other_calls++; return E_NOINTERFACE; }
+	ULONG STDMETHODCALLTYPE AddRef() { return 1; }
+	ULONG STDMETHODCALLTYPE Release() { return 1; }
+	void STDMETHODCALLTYPE GetDevice(ID3D11Device **dev) { other_calls++; *dev = 0; }
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT *size, void *data) { other_calls++; return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT size, const void *data) { other_calls++; return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown *data) { other_calls++; return E_NOTIMPL; }
+
+	// everything else the state cache should never call
+	void STDMETHODCALLTYPE PSSetShaderResources(UINT, UINT, ID3D11ShaderResourceView *const*) { other_calls++; }
+	void STDMETHODCALLTYPE PSSetSamplers(UINT, UINT, ID3D11SamplerState *const*) { other_calls++; }
+	void STDMETHODCALLTYPE DrawIndexed(UINT, UINT, INT) { other_calls++; }
+	void STDMETHODCALLTYPE Draw(UINT, UINT) { other_calls++; }
+	HRESULT STDMETHODCALLTYPE Map(ID3D11Resource*, UINT, D3D11_MAP, UINT, D3D11_MAPPED_SUBRESOURCE*) { other_calls++; return E_NOTIMPL; }
+	void STDMETHODCALLTYPE Unmap(ID3D11Resource*, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE IASetIndexBuffer(ID3D11Buffer*, DXGI_FORMAT, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE DrawIndexedInstanced(UINT, UINT, UINT, INT, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE DrawInstanced(UINT, UINT, UINT, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE GSSetConstantBuffers(UINT, UINT, ID3D11Buffer *const*) { other_calls++; }
+	void STDMETHODCALLTYPE GSSetShader(ID3D11GeometryShader*, ID3D11ClassInstance *const*, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE VSSetShaderResources(UINT, UINT, ID3D11ShaderResourceView *const*) { other_calls++; }
+	void STDMETHODCALLTYPE VSSetSamplers(UINT, UINT, ID3D11SamplerState *const*) { other_calls++; }
+	void STDMETHODCALLTYPE Begin(ID3D11Asynchronous*) { other_calls++; }
+	void STDMETHODCALLTYPE End(ID3D11Asynchronous*) { other_calls++; }
+	HRESULT STDMETHODCALLTYPE GetData(ID3D11Asynchronous*, void*, UINT, UINT) { other_calls++; return E_NOTIMPL; }
+	void STDMETHODCALLTYPE SetPredication(ID3D11Predicate*, BOOL) { other_calls++; }
+	void STDMETHODCALLTYPE GSSetShaderResources(UINT, UINT, ID3D11ShaderResourceView *const*) { other_calls++; }
+	void STDMETHODCALLTYPE GSSetSamplers(UINT, UINT, ID3D11SamplerState *const*) { other_calls++; }
+	void STDMETHODCALLTYPE OMSetRenderTargets(UINT, ID3D11RenderTargetView *const*, ID3D11DepthStencilView*) { other_calls++; }
+	void STDMETHODCALLTYPE OMSetRenderTargetsAndUnorderedAccessViews(UINT, ID3D11RenderTargetView *const*,
+			ID3D11DepthStencilView*, UINT, UINT, ID3D11UnorderedAccessView *const*, const UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE OMSetBlendState(ID3D11BlendState*, const FLOAT[4], UINT) { other_calls++; }
+	void STDMETHODCALLTYPE OMSetDepthStencilState(ID3D11DepthStencilState*, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE SOSetTargets(UINT, ID3D11Buffer *const*, const UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE DrawAuto() { other_calls++; }
+	void STDMETHODCALLTYPE DrawIndexedInstancedIndirect(ID3D11Buffer*, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE DrawInstancedIndirect(ID3D11Buffer*, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE Dispatch(UINT, UINT, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE DispatchIndirect(ID3D11Buffer*, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE RSSetState(ID3D11RasterizerState*) { other_calls++; }
+	void STDMETHODCALLTYPE RSSetViewports(UINT, const D3D11_VIEWPORT*) { other_calls++; }
+	void STDMETHODCALLTYPE RSSetScissorRects(UINT, const D3D11_RECT*) { other_calls++; }
+	void STDMETHODCALLTYPE CopySubresourceRegion(ID3D11Resource*, UINT, UINT, UINT, UINT, ID3D11Resource*,
+			UINT, const D3D11_BOX*) { other_calls++; }
+	void STDMETHODCALLTYPE CopyResource(ID3D11Resource*, ID3D11Resource*) { other_calls++; }
+	void STDMETHODCALLTYPE UpdateSubresource(ID3D11Resource*, UINT, const D3D11_BOX*, const void*, UINT, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE CopyStructureCount(ID3D11Buffer*, UINT, ID3D11UnorderedAccessView*) { other_calls++; }
+	void STDMETHODCALLTYPE ClearRenderTargetView(ID3D11RenderTargetView*, const FLOAT[4]) { other_calls++; }
+	void STDMETHODCALLTYPE ClearUnorderedAccessViewUint(ID3D11UnorderedAccessView*, const UINT[4]) { other_calls++; }
+	void STDMETHODCALLTYPE ClearUnorderedAccessViewFloat(ID3D11UnorderedAccessView*, const FLOAT[4]) { other_calls++; }
+	void STDMETHODCALLTYPE ClearDepthStencilView(ID3D11DepthStencilView*, UINT, FLOAT, UINT8) { other_calls++; }
+	void STDMETHODCALLTYPE GenerateMips(ID3D11ShaderResourceView*) { other_calls++; }
+	void STDMETHODCALLTYPE SetResourceMinLOD(ID3D11Resource*, FLOAT) { other_calls++; }
+	FLOAT STDMETHODCALLTYPE GetResourceMinLOD(ID3D11Resource*) { other_calls++; return 0.0f; }
+	void STDMETHODCALLTYPE ResolveSubresource(ID3D11Resource*, UINT, ID3D11Resource*, UINT, DXGI_FORMAT) { other_calls++; }
+	void STDMETHODCALLTYPE ExecuteCommandList(ID3D11CommandList*, BOOL) { other_calls++; }
+	void STDMETHODCALLTYPE HSSetShaderResources(UINT, UINT, ID3D11ShaderResourceView *const*) { other_calls++; }
+	void STDMETHODCALLTYPE HSSetShader(ID3D11HullShader*, ID3D11ClassInstance *const*, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE HSSetSamplers(UINT, UINT, ID3D11SamplerState *const*) { other_calls++; }
+	void STDMETHODCALLTYPE HSSetConstantBuffers(UINT, UINT, ID3D11Buffer *const*) { other_calls++; }
+	void STDMETHODCALLTYPE DSSetShaderResources(UINT, UINT, ID3D11ShaderResourceView *const*) { other_calls++; }
+	void STDMETHODCALLTYPE DSSetShader(ID3D11DomainShader*, ID3D11ClassInstance *const*, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE DSSetSamplers(UINT, UINT, ID3D11SamplerState *const*) { other_calls++; }
+	void STDMETHODCALLTYPE DSSetConstantBuffers(UINT, UINT, ID3D11Buffer *const*) { other_calls++; }
+	void STDMETHODCALLTYPE CSSetShaderResources(UINT, UINT, ID3D11ShaderResourceView *const*) { other_calls++; }
+	void STDMETHODCALLTYPE CSSetUnorderedAccessViews(UINT, UINT, ID3D11UnorderedAccessView *const*, const UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE CSSetShader(ID3D11ComputeShader*, ID3D11ClassInstance *const*, UINT) { other_calls++; }
+	void STDMETHODCALLTYPE CSSetSamplers(UINT, UINT, ID3D11SamplerState *const*) { other_calls++; }
+	void STDMETHODCALLTYPE CSSetConstantBuffers(UINT, UINT, ID3D11Buffer *const*) { other_calls++; }
+	void STDMETHODCALLTYPE VSGetConstantBuffers(UINT, UINT, ID3D11Buffer**) { other_calls++; }
+	void STDMETHODCALLTYPE PSGetShaderResources(UINT, UINT, ID3D11ShaderResourceView**) { other_calls++; }
+	void STDMETHODCALLTYPE PSGetShader(ID3D11PixelShader**, ID3D11ClassInstance**, UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE PSGetSamplers(UINT, UINT, ID3D11SamplerState**) { other_calls++; }
+	void STDMETHODCALLTYPE VSGetShader(ID3D11VertexShader**, ID3D11ClassInstance**, UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE PSGetConstantBuffers(UINT, UINT, ID3D11Buffer**) { other_calls++; }
+	void STDMETHODCALLTYPE IAGetInputLayout(ID3D11InputLayout**) { other_calls++; }
+	void STDMETHODCALLTYPE IAGetVertexBuffers(UINT, UINT, ID3D11Buffer**, UINT*, UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE IAGetIndexBuffer(ID3D11Buffer**, DXGI_FORMAT*, UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE GSGetConstantBuffers(UINT, UINT, ID3D11Buffer**) { other_calls++; }
+	void STDMETHODCALLTYPE GSGetShader(ID3D11GeometryShader**, ID3D11ClassInstance**, UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE IAGetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY*) { other_calls++; }
+	void STDMETHODCALLTYPE VSGetShaderResources(UINT, UINT, ID3D11ShaderResourceView**) { other_calls++; }
+	void STDMETHODCALLTYPE VSGetSamplers(UINT, UINT, ID3D11SamplerState**) { other_calls++; }
+	void STDMETHODCALLTYPE GetPredication(ID3D11Predicate**, BOOL*) { other_calls++; }
+	void STDMETHODCALLTYPE GSGetShaderResources(UINT, UINT, ID3D11ShaderResourceView**) { other_calls++; }
+	void STDMETHODCALLTYPE GSGetSamplers(UINT, UINT, ID3D11SamplerState**) { other_calls++; }
+	void STDMETHODCALLTYPE OMGetRenderTargets(UINT, ID3D11RenderTargetView**, ID3D11DepthStencilView**) { other_calls++; }
+	void STDMETHODCALLTYPE OMGetRenderTargetsAndUnorderedAccessViews(UINT, ID3D11RenderTargetView**,
+			ID3D11DepthStencilView**, UINT, UINT, ID3D11UnorderedAccessView**) { other_calls++; }
+	void STDMETHODCALLTYPE OMGetBlendState(ID3D11BlendState**, FLOAT[4], UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE OMGetDepthStencilState(ID3D11DepthStencilState**, UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE SOGetTargets(UINT, ID3D11Buffer**) { other_calls++; }
+	void STDMETHODCALLTYPE RSGetState(ID3D11RasterizerState**) { other_calls++; }
+	void STDMETHODCALLTYPE RSGetViewports(UINT*, D3D11_VIEWPORT*) { other_calls++; }
+	void STDMETHODCALLTYPE RSGetScissorRects(UINT*, D3D11_RECT*) { other_calls++; }
+	void STDMETHODCALLTYPE HSGetShaderResources(UINT, UINT, ID3D11ShaderResourceView**) { other_calls++; }
+	void STDMETHODCALLTYPE HSGetShader(ID3D11HullShader**, ID3D11ClassInstance**, UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE HSGetSamplers(UINT, UINT, ID3D11SamplerState**) { other_calls++; }
+	void STDMETHODCALLTYPE HSGetConstantBuffers(UINT, UINT, ID3D11Buffer**) { other_calls++; }
+	void STDMETHODCALLTYPE DSGetShaderResources(UINT, UINT, ID3D11ShaderResourceView**) { other_calls++; }
+	void STDMETHODCALLTYPE DSGetShader(ID3D11DomainShader**, ID3D11ClassInstance**, UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE DSGetSamplers(UINT, UINT, ID3D11SamplerState**) { other_calls++; }
+	void STDMETHODCALLTYPE DSGetConstantBuffers(UINT, UINT, ID3D11Buffer**) { other_calls++; }
+	void STDMETHODCALLTYPE CSGetShaderResources(UINT, UINT, ID3D11ShaderResourceView**) { other_calls++; }
+	void STDMETHODCALLTYPE CSGetUnorderedAccessViews(UINT, UINT, ID3D11UnorderedAccessView**) { other_calls++; }
+	void STDMETHODCALLTYPE CSGetShader(ID3D11ComputeShader**, ID3D11ClassInstance**, UINT*) { other_calls++; }
+	void STDMETHODCALLTYPE CSGetSamplers(UINT, UINT, ID3D11SamplerState**) { other_calls++; }
+	void STDMETHODCALLTYPE CSGetConstantBuffers(UINT, UINT, ID3D11Buffer**) { other_calls++; }
+	void STDMETHODCALLTYPE ClearState() { other_calls++; }
+	void STDMETHODCALLTYPE Flush() { other_calls++; }
+	D3D11_DEVICE_CONTEXT_TYPE STDMETHODCALLTYPE GetType() { return D3D11_DEVICE_CONTEXT_IMMEDIATE; }
+	UINT STDMETHODCALLTYPE GetContextFlags() { return 0; }
+	HRESULT STDMETHODCALLTYPE FinishCommandList(BOOL, ID3D11CommandList**) { other_calls++; return E_NOTIMPL; }
+};
+
+#endif	// MOCKCTX_H_
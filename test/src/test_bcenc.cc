@@ -0,0 +1,277 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "bcenc.h"
+#include "thrpool.h"
+#include "alloc.h"
+
+typedef MemVector<unsigned char, MEM_MISC>::type ByteArray;
+
+// not a multiple of 4 in either direction, and large enough to be split across threads
+#define IMG_WIDTH	509
+#define IMG_HEIGHT	381
+
+/* reference decoder, written from the format description independently of
+ * the encoder: 565 endpoints expanded by bit replication, palettes
+ * interpolated in 8bit with rounding.
+ */
+static void expand565(int c, int *rgb)
+{
+	int r = (c >> 11) & 0x1f;
+	int g = (c >> 5) & 0x3f;
+	int b = c & 0x1f;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+// decodes a BC1 block into 16 RGBA pixels. BC3 color blocks always use 4 colors
+static void decode_bc1(const unsigned char *src, bool force4, unsigned char *block)
+{
+	int c0 = src[0] | (src[1] << 8);
+	int c1 = src[2] | (src[3] << 8);
+	int pal[4][4];
+
+	expand565(c0, pal[0]);
+	expand565(c1, pal[1]);
+	bool four = c0 > c1 || force4;
+	for(int i=0; i<3; i++) {
+		if(four) {
+			pal[2][i] = (2 * pal[0][i] + pal[1][i] + 1) / 3;
+			pal[3][i] = (pal[0][i] + 2 * pal[1][i] + 1) / 3;
+		} else {
+			pal[2][i] = (pal[0][i] + pal[1][i]) / 2;
+			pal[3][i] = 0;
+		}
+	}
+	pal[0][3] = pal[1][3] = pal[2][3] = 255;
+	pal[3][3] = four ? 255 : 0;
+
+	unsigned int indices = src[4] | (src[5] << 8) | (src[6] << 16) | ((unsigned int)src[7] << 24);
+	for(int i=0; i<16; i++) {
+		const int *c = pal[(indices >> (i * 2)) & 3];
+		for(int j=0; j<4; j++) {
+			block[i * 4 + j] = (unsigned char)c[j];
+		}
+	}
+}
+
+// decodes a BC4 block into one channel of 16 RGBA pixels
+static void decode_bc4(const unsigned char *src, unsigned char *block)
+{
+	int a0 = src[0], a1 = src[1];
+	int pal[8];
+
+	pal[0] = a0;
+	pal[1] = a1;
+	if(a0 > a1) {
+		for(int i=1; i<7; i++) {
+			pal[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+		}
+	} else {
+		for(int i=1; i<5; i++) {
+			pal[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+		}
+		pal[6] = 0;
+		pal[7] = 255;
+	}
+
+	unsigned long long indices = 0;
+	for(int i=0; i<6; i++) {
+		indices |= (unsigned long long)src[i + 2] << (i * 8);
+	}
+	for(int i=0; i<16; i++) {
+		block[i * 4] = (unsigned char)pal[(indices >> (i * 3)) & 7];
+	}
+}
+
+// decodes into an RGBA8 image; channels the format doesn't store are left as they are
+static void decode_image(int fmt, const unsigned char *src, int xsz, int ysz, unsigned char *pixels)
+{
+	int bw = (xsz + 3) / 4, bh = (ysz + 3) / 4;
+	int bsize = fmt == BCFMT_BC1 ? 8 : 16;
+
+	for(int by=0; by<bh; by++) {
+		for(int bx=0; bx<bw; bx++) {
+			unsigned char block[64];
+			switch(fmt) {
+			case BCFMT_BC1:
+				decode_bc1(src, false, block);
+				break;
+			case BCFMT_BC3:
+				decode_bc1(src + 8, true, block);
+				decode_bc4(src, block + 3);
+				break;
+			case BCFMT_BC5:
+				decode_bc4(src, block);
+				decode_bc4(src + 8, block + 1);
+				break;
+			}
+			src += bsize;
+
+			for(int i=0; i<4; i++) {
+				int y = by * 4 + i;
+				for(int j=0; j<4; j++) {
+					int x = bx * 4 + j;
+					if(x >= xsz || y >= ysz) continue;
+
+					unsigned char *dptr = pixels + (y * xsz + x) * 4;
+					const unsigned char *sptr = block + (i * 4 + j) * 4;
+					int nchan = fmt == BCFMT_BC5 ? 2 : 4;
+					memcpy(dptr, sptr, nchan);
+				}
+			}
+		}
+	}
+}
+
+// PSNR of channels [first, first + count) in dB
+static double psnr(const unsigned char *a, const unsigned char *b, int npix, int first, int count)
+{
+	double err = 0.0;
+	for(int i=0; i<npix; i++) {
+		for(int j=first; j<first + count; j++) {
+			double d = (double)a[i * 4 + j] - (double)b[i * 4 + j];
+			err += d * d;
+		}
+	}
+	err /= (double)npix * count;
+	return err > 0.0 ? 10.0 * log10(255.0 * 255.0 / err) : 100.0;
+}
+
+/* smooth color waves, a gradient and stepped alpha, with isolated noisy
+ * pixels: both easy blocks and ones which don't fit a line in color space
+ */
+static void gen_image(unsigned char *pixels)
+{
+	unsigned int rng = 1;
+	for(int i=0; i<IMG_HEIGHT; i++) {
+		for(int j=0; j<IMG_WIDTH; j++) {
+			unsigned char *px = pixels + (i * IMG_WIDTH + j) * 4;
+			float fx = (float)j / IMG_WIDTH, fy = (float)i / IMG_HEIGHT;
+
+			px[0] = (unsigned char)(127.5f + 127.5f * sin(fx * 17.0f + fy * 3.0f));
+			px[1] = (unsigned char)(255.0f * fx * fy);
+			px[2] = (unsigned char)(127.5f + 127.5f * cos(fy * 23.0f - fx * 5.0f));
+			px[3] = (j / 7 + i / 5) % 3 == 0 ? 255 : (unsigned char)(255.0f * fy);
+
+			rng = rng * 1664525 + 1013904223;
+			if((j * 7 + i * 13) % 97 == 0) {
+				px[0] = (unsigned char)(rng >> 24);
+				px[1] = (unsigned char)(rng >> 16);
+				px[2] = (unsigned char)(rng >> 8);
+			}
+		}
+	}
+}
+
+/* minimum PSNR for each format, in fast and quality mode. The encoder scores
+ * about 2 dB above these on the test image; a broken endpoint fit or index
+ * selection drops far below.
+ */
+static const struct {
+	int fmt;
+	int first_chan, num_chan;
+	double min_psnr[2];
+} quality_checks[] = {
+	{BCFMT_BC1, 0, 3, {34.0, 37.0}},
+	{BCFMT_BC3, 0, 3, {34.0, 37.0}},
+	{BCFMT_BC3, 3, 1, {48.0, 55.0}},
+	{BCFMT_BC5, 0, 2, {44.0, 46.0}}
+};
+
+static void test_quality(const unsigned char *img, ByteArray &enc, ByteArray &dec)
+{
+	int npix = IMG_WIDTH * IMG_HEIGHT;
+
+	for(int i=0; i<(int)(sizeof quality_checks / sizeof *quality_checks); i++) {
+		int fmt = quality_checks[i].fmt;
+		int first = quality_checks[i].first_chan, count = quality_checks[i].num_chan;
+		double db[2];
+
+		for(int q=0; q<2; q++) {
+			enc.assign(bc_size(fmt, IMG_WIDTH, IMG_HEIGHT), 0);
+			bc_encode(fmt, q != 0, IMG_WIDTH, IMG_HEIGHT, img, &enc[0]);
+
+			dec.assign(img, img + npix * 4);
+			decode_image(fmt, &enc[0], IMG_WIDTH, IMG_HEIGHT, &dec[0]);
+
+			db[q] = psnr(img, &dec[0], npix, first, count);
+			if(db[q] < quality_checks[i].min_psnr[q]) {
+				fprintf(stderr, "format %d, channels %d-%d, %s: %.2f dB\n", fmt, first,
+						first + count - 1, q ? "quality" : "fast", db[q]);
+			}
+			CHECK(db[q] >= quality_checks[i].min_psnr[q]);
+		}
+		CHECK(db[1] >= db[0]);
+	}
+}
+
+// rows of blocks split across threads must give the same output as one thread
+static void test_threads(const unsigned char *img)
+{
+	for(int fmt=BCFMT_BC1; fmt<=BCFMT_BC5; fmt++) {
+		size_t size = bc_size(fmt, IMG_WIDTH, IMG_HEIGHT);
+		ByteArray single(size), multi(size);
+
+		init_thread_pool(1);
+		bc_encode(fmt, true, IMG_WIDTH, IMG_HEIGHT, img, &single[0]);
+		init_thread_pool(4);
+		bc_encode(fmt, true, IMG_WIDTH, IMG_HEIGHT, img, &multi[0]);
+
+		CHECK(single == multi);
+	}
+	destroy_thread_pool();
+}
+
+// a single pixel image is one block of repeated pixels, which must come back close
+static void test_single_pixel()
+{
+	static const unsigned char pix[4] = {10, 200, 30, 77};
+
+	for(int fmt=BCFMT_BC1; fmt<=BCFMT_BC5; fmt++) {
+		unsigned char enc[16], dec[4] = {0, 0, 0, 0};
+		CHECK(bc_size(fmt, 1, 1) == (fmt == BCFMT_BC1 ? 8u : 16u));
+
+		bc_encode(fmt, true, 1, 1, pix, enc);
+		decode_image(fmt, enc, 1, 1, dec);
+
+		if(fmt == BCFMT_BC5) {
+			CHECK(dec[0] == pix[0] && dec[1] == pix[1]);
+		} else {
+			// within the 565 quantization step
+			CHECK(abs(dec[0] - pix[0]) <= 4 && abs(dec[1] - pix[1]) <= 2 && abs(dec[2] - pix[2]) <= 4);
+		}
+		if(fmt == BCFMT_BC3) {
+			CHECK(dec[3] == pix[3]);
+		}
+	}
+}
+
+void test_bcenc()
+{
+	ByteArray img(IMG_WIDTH * IMG_HEIGHT * 4), enc, dec;
+	gen_image(&img[0]);
+
+	test_quality(&img[0], enc, dec);
+	test_threads(&img[0]);
+	test_single_pixel();
+}
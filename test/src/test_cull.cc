@@ -0,0 +1,197 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include "test.h"
+#include "cull.h"
+#include "thrpool.h"
+#include "simd.h"
+#include "alloc.h"
+
+typedef MemVector<float, MEM_MISC>::type FloatArray;
+typedef MemVector<int, MEM_MISC>::type IntArray;
+
+// past the end of the output, must survive every call
+#define SENTINEL	0x7eadbeef
+#define NUM_GUARD	16
+
+/* not multiples of the SIMD width, and on both sides of the threading
+ * threshold (64k), where the output is joined from per-job ranges
+ */
+static const int counts[] = {0, 1, 3, 7, 8, 9, 33, 1000, 4097, 65535, 65536, 65537, 200003};
+
+static unsigned int rng_state;
+
+static float frand(float lo, float hi)
+{
+	rng_state = rng_state * 1664525 + 1013904223;
+	return lo + (hi - lo) * (float)(rng_state >> 8) / 16777216.0f;
+}
+
+struct Volumes {
+	FloatArray x, y, z, radius;
+	FloatArray max_x, max_y, max_z;
+
+	void gen(int count)
+	{
+		x.resize(count); y.resize(count); z.resize(count); radius.resize(count);
+		max_x.resize(count); max_y.resize(count); max_z.resize(count);
+
+		// about half of them visible, with plenty straddling the planes
+		for(int i=0; i<count; i++) {
+			x[i] = frand(-150.0f, 150.0f);
+			y[i] = frand(-150.0f, 150.0f);
+			z[i] = frand(-20.0f, 150.0f);
+			radius[i] = frand(0.0f, 5.0f);
+			max_x[i] = x[i] + frand(0.0f, 10.0f);
+			max_y[i] = y[i] + frand(0.0f, 10.0f);
+			max_z[i] = z[i] + frand(0.0f, 10.0f);
+		}
+	}
+};
+
+// plane distance, summed in the same order as the SIMD versions
+static float plane_dist(const float *p, float x, float y, float z)
+{
+	return (p[0] * x + p[1] * y) + (p[2] * z + p[3]);
+}
+
+static void ref_spheres(const D3DUT_Frustum *fr, const Volumes &v, int count, IntArray &res)
+{
+	res.clear();
+	for(int i=0; i<count; i++) {
+		bool inside = true;
+		for(int j=0; j<6; j++) {
+			if(plane_dist(fr->plane[j], v.x[i], v.y[i], v.z[i]) < -v.radius[i]) {
+				inside = false;
+			}
+		}
+		if(inside) res.push_back(i);
+	}
+}
+
+// a box is outside if its corner furthest along the plane normal is
+static void ref_aabbs(const D3DUT_Frustum *fr, const Volumes &v, int count, IntArray &res)
+{
+	res.clear();
+	for(int i=0; i<count; i++) {
+		bool inside = true;
+		for(int j=0; j<6; j++) {
+			const float *p = fr->plane[j];
+			float x = p[0] >= 0.0f ? v.max_x[i] : v.x[i];
+			float y = p[1] >= 0.0f ? v.max_y[i] : v.y[i];
+			float z = p[2] >= 0.0f ? v.max_z[i] : v.z[i];
+			if(plane_dist(p, x, y, z) < 0.0f) {
+				inside = false;
+			}
+		}
+		if(inside) res.push_back(i);
+	}
+}
+
+static bool check_result(const IntArray &visible, int num_visible, const IntArray &ref, int count)
+{
+	if(num_visible != (int)ref.size()) {
+		return false;
+	}
+	for(int i=0; i<num_visible; i++) {
+		if(visible[i] != ref[i]) return false;
+	}
+	for(int i=0; i<NUM_GUARD; i++) {
+		if(visible[count + i] != SENTINEL) return false;
+	}
+	return true;
+}
+
+static void test_counts(const D3DUT_Frustum *fr, const char *path, int nthreads)
+{
+	Volumes v;
+	IntArray visible, ref;
+
+	D3DUT_Spheres spheres;
+	D3DUT_AABBs boxes;
+
+	init_thread_pool(nthreads);
+
+	for(int i=0; i<(int)(sizeof counts / sizeof *counts); i++) {
+		int count = counts[i];
+		rng_state = count + 1;
+		v.gen(count);
+		visible.assign(count + NUM_GUARD, SENTINEL);
+
+		// empty vectors have no element to point at
+		float dummy = 0.0f;
+		spheres.x = count ? &v.x[0] : &dummy;
+		spheres.y = count ? &v.y[0] : &dummy;
+		spheres.z = count ? &v.z[0] : &dummy;
+		spheres.radius = count ? &v.radius[0] : &dummy;
+		boxes.min_x = spheres.x;
+		boxes.min_y = spheres.y;
+		boxes.min_z = spheres.z;
+		boxes.max_x = count ? &v.max_x[0] : &dummy;
+		boxes.max_y = count ? &v.max_y[0] : &dummy;
+		boxes.max_z = count ? &v.max_z[0] : &dummy;
+
+		ref_spheres(fr, v, count, ref);
+		int num = cull_spheres(fr, &spheres, count, &visible[0]);
+		if(!check_result(visible, num, ref, count)) {
+			fprintf(stderr, "cull_spheres, %s, %d threads, count %d: %d visible (expected %d), or output overrun\n",
+					path, nthreads, count, num, (int)ref.size());
+			test_failures++;
+		}
+
+		visible.assign(count + NUM_GUARD, SENTINEL);
+		ref_aabbs(fr, v, count, ref);
+		num = cull_aabbs(fr, &boxes, count, &visible[0]);
+		if(!check_result(visible, num, ref, count)) {
+			fprintf(stderr, "cull_aabbs, %s, %d threads, count %d: %d visible (expected %d), or output overrun\n",
+					path, nthreads, count, num, (int)ref.size());
+			test_failures++;
+		}
+	}
+
+	destroy_thread_pool();
+}
+
+void test_cull()
+{
+	// 90 degree perspective looking down +z, near 1, far 100, D3D depth range
+	static const float proj[16] = {
+		1, 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, 100.0f / 99.0f, -100.0f / 99.0f,
+		0, 0, 1, 0
+	};
+	D3DUT_Frustum fr;
+	frustum_from_matrix(proj, &fr);
+
+	// near plane faces +z, left plane faces right
+	CHECK(fr.plane[4][2] > 0.99f && fabs(fr.plane[4][3] + 1.0f) < 1e-4f);
+	CHECK(fr.plane[0][0] > 0.7f && fr.plane[0][2] > 0.7f);
+
+	/* 4 threads even on a single CPU, so that counts above the threshold are
+	 * split, with chunk boundaries which aren't multiples of the SIMD width
+	 */
+	if(cpu_has_avx2()) {
+		test_counts(&fr, "avx2", 1);
+		test_counts(&fr, "avx2", 4);
+	}
+	cpu_disable_avx(true);
+	test_counts(&fr, "sse", 1);
+	test_counts(&fr, "sse", 4);
+	cpu_disable_avx(false);
+}
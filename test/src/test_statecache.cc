@@ -0,0 +1,162 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "test.h"
+#include "mockctx.h"
+#include "statecache.h"
+
+// the cache only compares pointers, so fake objects are just distinct addresses
+static char fake_obj[64];
+#define FAKE(type, i)	((type*)(fake_obj + (i)))
+
+static bool check_call(const MockContext &ctx, int idx, int func, unsigned int start, unsigned int count)
+{
+	if(idx >= (int)ctx.calls.size()) return false;
+	const MockCall &call = ctx.calls[idx];
+	return call.func == func && call.start == start && call.count == count;
+}
+
+static void test_single_state(MockContext &ctx, StateCache &sc)
+{
+	ctx.clear();
+	sc.set_input_layout(FAKE(ID3D11InputLayout, 1));
+	sc.set_input_layout(FAKE(ID3D11InputLayout, 1));
+	sc.set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	sc.set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	sc.set_vertex_shader(FAKE(ID3D11VertexShader, 2));
+	sc.set_vertex_shader(FAKE(ID3D11VertexShader, 2));
+	sc.set_pixel_shader(FAKE(ID3D11PixelShader, 3));
+	sc.set_pixel_shader(FAKE(ID3D11PixelShader, 3));
+
+	CHECK(ctx.calls.size() == 4);
+	CHECK(check_call(ctx, 0, MOCK_IA_LAYOUT, 0, 1));
+	CHECK(check_call(ctx, 1, MOCK_IA_TOPOLOGY, 0, 1));
+	CHECK(check_call(ctx, 2, MOCK_VS_SHADER, 0, 1));
+	CHECK(check_call(ctx, 3, MOCK_PS_SHADER, 0, 1));
+	CHECK(sc.get_issued() == 4 && sc.get_skipped() == 4);
+
+	// a change is forwarded, and so is unbinding
+	ctx.clear();
+	sc.set_vertex_shader(FAKE(ID3D11VertexShader, 4));
+	sc.set_pixel_shader(0);
+	CHECK(ctx.calls.size() == 2);
+	CHECK(check_call(ctx, 0, MOCK_VS_SHADER, 0, 1) && ctx.calls[0].obj[0] == FAKE(ID3D11VertexShader, 4));
+	CHECK(check_call(ctx, 1, MOCK_PS_SHADER, 0, 1) && ctx.calls[1].obj[0] == 0);
+
+	// after invalidate everything must be reissued, even if it's the same
+	ctx.clear();
+	sc.invalidate();
+	sc.set_input_layout(FAKE(ID3D11InputLayout, 1));
+	sc.set_primitive_topology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	CHECK(ctx.calls.size() == 2);
+	CHECK(check_call(ctx, 1, MOCK_IA_TOPOLOGY, 0, 1) && ctx.calls[1].value == D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+static void test_vertex_buffers(MockContext &ctx, StateCache &sc)
+{
+	ID3D11Buffer *bufs[] = {FAKE(ID3D11Buffer, 10), FAKE(ID3D11Buffer, 11), FAKE(ID3D11Buffer, 12), FAKE(ID3D11Buffer, 13)};
+	unsigned int strides[] = {32, 16, 12, 64};
+	unsigned int offs[] = {0, 0, 0, 0};
+
+	ctx.clear();
+	sc.set_vertex_buffers(0, 4, bufs, strides, offs);
+	CHECK(ctx.calls.size() == 1 && check_call(ctx, 0, MOCK_IA_VBUFS, 0, 4));
+
+	// identical rebind is skipped
+	ctx.clear();
+	sc.reset_counters();
+	sc.set_vertex_buffers(0, 4, bufs, strides, offs);
+	CHECK(ctx.calls.empty());
+	CHECK(sc.get_issued() == 0 && sc.get_skipped() == 1);
+
+	// only the changed slot is reissued
+	ctx.clear();
+	bufs[2] = FAKE(ID3D11Buffer, 20);
+	sc.set_vertex_buffers(0, 4, bufs, strides, offs);
+	CHECK(ctx.calls.size() == 1 && check_call(ctx, 0, MOCK_IA_VBUFS, 2, 1));
+	CHECK(ctx.calls[0].obj[0] == bufs[2] && ctx.calls[0].stride[0] == 12);
+
+	// non-adjacent changes are sent as the range covering both
+	ctx.clear();
+	bufs[1] = FAKE(ID3D11Buffer, 21);
+	bufs[3] = FAKE(ID3D11Buffer, 23);
+	sc.set_vertex_buffers(0, 4, bufs, strides, offs);
+	CHECK(ctx.calls.size() == 1 && check_call(ctx, 0, MOCK_IA_VBUFS, 1, 3));
+	CHECK(ctx.calls[0].obj[0] == bufs[1] && ctx.calls[0].obj[1] == bufs[2] && ctx.calls[0].obj[2] == bufs[3]);
+
+	// stride and offset changes count too
+	ctx.clear();
+	strides[0] = 48;
+	offs[3] = 256;
+	sc.set_vertex_buffers(0, 1, bufs, strides, offs);
+	sc.set_vertex_buffers(3, 1, bufs + 3, strides + 3, offs + 3);
+	CHECK(ctx.calls.size() == 2);
+	CHECK(check_call(ctx, 0, MOCK_IA_VBUFS, 0, 1) && ctx.calls[0].stride[0] == 48);
+	CHECK(check_call(ctx, 1, MOCK_IA_VBUFS, 3, 1) && ctx.calls[1].offset[0] == 256);
+
+	// a sub-range of the start offset is compared against the right slots
+	ctx.clear();
+	sc.set_vertex_buffers(1, 2, bufs + 1, strides + 1, offs + 1);
+	CHECK(ctx.calls.empty());
+
+	// ranges past the last slot are passed through untouched
+	ctx.clear();
+	sc.set_vertex_buffers(SC_MAX_VBUFS - 2, 4, bufs, strides, offs);
+	CHECK(ctx.calls.size() == 1 && check_call(ctx, 0, MOCK_IA_VBUFS, SC_MAX_VBUFS - 2, 4));
+}
+
+static void test_constant_buffers(MockContext &ctx, StateCache &sc)
+{
+	ID3D11Buffer *bufs[] = {FAKE(ID3D11Buffer, 30), FAKE(ID3D11Buffer, 31), FAKE(ID3D11Buffer, 32)};
+
+	// vertex and pixel shader slots are tracked separately
+	ctx.clear();
+	sc.set_vs_constant_buffers(0, 3, bufs);
+	sc.set_ps_constant_buffers(0, 3, bufs);
+	sc.set_vs_constant_buffers(0, 3, bufs);
+	sc.set_ps_constant_buffers(0, 3, bufs);
+	CHECK(ctx.calls.size() == 2);
+	CHECK(check_call(ctx, 0, MOCK_VS_CBUFS, 0, 3));
+	CHECK(check_call(ctx, 1, MOCK_PS_CBUFS, 0, 3));
+
+	ctx.clear();
+	bufs[1] = FAKE(ID3D11Buffer, 41);
+	sc.set_vs_constant_buffers(0, 3, bufs);
+	sc.set_ps_constant_buffers(1, 2, bufs + 1);
+	CHECK(ctx.calls.size() == 2);
+	CHECK(check_call(ctx, 0, MOCK_VS_CBUFS, 1, 1) && ctx.calls[0].obj[0] == bufs[1]);
+	CHECK(check_call(ctx, 1, MOCK_PS_CBUFS, 1, 1) && ctx.calls[1].obj[0] == bufs[1]);
+
+	// slots not bound before are never assumed to hold null
+	ctx.clear();
+	ID3D11Buffer *null_buf = 0;
+	sc.set_ps_constant_buffers(5, 1, &null_buf);
+	CHECK(ctx.calls.size() == 1 && check_call(ctx, 0, MOCK_PS_CBUFS, 5, 1));
+}
+
+void test_statecache()
+{
+	MockContext ctx;
+	StateCache sc;
+	sc.set_context(&ctx);
+
+	test_single_state(ctx, sc);
+	test_vertex_buffers(ctx, sc);
+	test_constant_buffers(ctx, sc);
+
+	CHECK(ctx.other_calls == 0);
+}
@@ -0,0 +1,35 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BENCH_H_
+#define BENCH_H_
+
+// seconds since an arbitrary point, from the d3dut high resolution timer
+double bench_time();
+
+/* prints one result line: the time per run, and the throughput in the given
+ * unit (e.g. "Mpackets") when units_per_run is non-zero
+ */
+void bench_report(const char *name, int nthreads, double sec_per_run, double units_per_run, const char *unit);
+
+/* thread counts to run each benchmark with: single-threaded, then one thread
+ * per CPU if there's more than one
+ */
+extern int bench_thread_counts[2];
+extern int bench_num_thread_counts;
+
+#endif	// BENCH_H_
@@ -0,0 +1,117 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <windows.h>
+#include <stdio.h>
+#include "bench.h"
+#include "d3dut.h"
+#include "d3dut_app.h"
+#include "latency.h"
+
+#define NUM_EVENTS	10000000
+
+// function pointer path: d3dut's window procedure calling a registered callback
+static unsigned long long motion_sum;
+
+static void motion(int x, int y)
+{
+	motion_sum += x + y;
+}
+
+// static path: App's window procedure, with the handler inlined
+class BenchApp : public d3dut::App<BenchApp> {
+public:
+	unsigned long long motion_sum;
+
+	BenchApp() : motion_sum(0) {}
+
+	void motion(int x, int y)
+	{
+		motion_sum += x + y;
+	}
+};
+
+/* calls the window procedure directly rather than through SendMessage, to
+ * leave out the user32 dispatch cost which is the same for both paths.
+ * Both procedures are ANSI, so GWLP_WNDPROC is the function itself.
+ */
+static double dispatch_motion(HWND hwnd)
+{
+	WNDPROC proc = (WNDPROC)GetWindowLongPtr(hwnd, GWLP_WNDPROC);
+
+	double t0 = bench_time();
+	for(int i=0; i<NUM_EVENTS; i++) {
+		LPARAM lparam = MAKELPARAM(i & 0x3ff, (i >> 10) & 0x3ff);
+		proc(hwnd, WM_MOUSEMOVE, MK_LBUTTON, lparam);
+	}
+	return bench_time() - t0;
+}
+
+/* the d3dut window procedure also stamps each input event for the latency
+ * statistics, which App windows don't. Outside the main loop that's a timer
+ * read per event; it's timed on its own here, with the same code compiled
+ * into the benchmark, and taken out of the callback time.
+ */
+static double stamp_events(unsigned long long *sum)
+{
+	double t0 = bench_time();
+	for(int i=0; i<NUM_EVENTS; i++) {
+		*sum += input_arrival_time();
+	}
+	return bench_time() - t0;
+}
+
+static void report(const char *name, double sec)
+{
+	bench_report(name, 1, sec, NUM_EVENTS / 1e6, "Mevents");
+	printf("  %.2f ns per event\n", sec * 1e9 / NUM_EVENTS);
+}
+
+/* synthetic WM_MOUSEMOVE events dispatched to a motion handler through the
+ * d3dut callback path, and through d3dut::App. Needs to create windows and a
+ * device, which falls back to WARP without a GPU. The callback path also
+ * looks up the window among the d3dut windows, which is counted as dispatch:
+ * App gets to its object through the window's user data instead.
+ */
+void bench_app()
+{
+	d3dut_init(0, 0);
+	d3dut_init_window_size(64, 64);
+
+	int cb_win = d3dut_create_window("d3dut callback dispatch");
+	d3dut_motion_func(motion);
+	HWND cb_hwnd = d3dut_get_window_handle(cb_win);
+
+	BenchApp app;
+	app.create_window("d3dut::App dispatch");
+	HWND app_hwnd = d3dut_get_window_handle(app.get_window());
+
+	unsigned long long stamp_sum = 0;
+	double cb_time = dispatch_motion(cb_hwnd);
+	double stamp_time = stamp_events(&stamp_sum);
+	double app_time = dispatch_motion(app_hwnd);
+
+	report("app callback dispatch", cb_time);
+	report("app latency stamp", stamp_time);
+	report("app callback minus stamp", cb_time - stamp_time);
+	report("app static dispatch", app_time);
+
+	printf("  handler sums: callback %llu, static %llu (stamps %llu)\n", motion_sum, app.motion_sum, stamp_sum);
+
+	d3dut_destroy_window(app.get_window());
+	d3dut_destroy_window(cb_win);
+}
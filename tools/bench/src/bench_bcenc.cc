@@ -0,0 +1,76 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <stdio.h>
+#include "bench.h"
+#include "bcenc.h"
+#include "thrpool.h"
+
+#define IMAGE_SIZE	2048
+#define NUM_RUNS	3
+
+static const struct {
+	const char *name;
+	int fmt;
+	bool quality;
+} configs[] = {
+	{"bcenc BC1 fast", BCFMT_BC1, false},
+	{"bcenc BC1 quality", BCFMT_BC1, true},
+	{"bcenc BC3 fast", BCFMT_BC3, false},
+	{"bcenc BC3 quality", BCFMT_BC3, true},
+	{"bcenc BC5 fast", BCFMT_BC5, false},
+	{"bcenc BC5 quality", BCFMT_BC5, true}
+};
+
+/* compression of a 2048x2048 texture with smooth gradients and some noise, in
+ * megapixels per second. The block cache is off, so every run encodes.
+ */
+void bench_bcenc()
+{
+	MemVector<unsigned char, MEM_TEXTURES>::type pixels((size_t)IMAGE_SIZE * IMAGE_SIZE * 4);
+	unsigned int rng = 1;
+	for(int i=0; i<IMAGE_SIZE; i++) {
+		for(int j=0; j<IMAGE_SIZE; j++) {
+			unsigned char *px = &pixels[((size_t)i * IMAGE_SIZE + j) * 4];
+			rng = rng * 1664525 + 1013904223;
+			int noise = (int)(rng >> 28);
+			px[0] = (unsigned char)(127.5f + 127.5f * sin(j * 0.01f + i * 0.003f)) ^ noise;
+			px[1] = (unsigned char)((i + j) >> 4);
+			px[2] = (unsigned char)(127.5f + 127.5f * cos(i * 0.02f)) ^ noise;
+			px[3] = (unsigned char)(i >> 3);
+		}
+	}
+
+	MemVector<unsigned char, MEM_TEXTURES>::type dest(bc_size(BCFMT_BC3, IMAGE_SIZE, IMAGE_SIZE));
+	double mpix = IMAGE_SIZE * IMAGE_SIZE / 1e6;
+
+	for(int t=0; t<bench_num_thread_counts; t++) {
+		int nthreads = bench_thread_counts[t];
+		init_thread_pool(nthreads);
+
+		for(int c=0; c<(int)(sizeof configs / sizeof *configs); c++) {
+			double t0 = bench_time();
+			for(int i=0; i<NUM_RUNS; i++) {
+				bc_encode(configs[c].fmt, configs[c].quality, IMAGE_SIZE, IMAGE_SIZE, &pixels[0], &dest[0]);
+			}
+			bench_report(configs[c].name, nthreads, (bench_time() - t0) / NUM_RUNS, mpix, "MP");
+		}
+	}
+
+	destroy_thread_pool();
+}
@@ -0,0 +1,105 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include "bench.h"
+#include "imgenc.h"
+#include "thrpool.h"
+
+#define FRAME_WIDTH		1920
+#define FRAME_HEIGHT	1080
+#define NUM_FRAMES		32
+
+typedef void (*EncodeFunc)(const unsigned char *pixels, int width, int height, int pitch, ImgBuffer *out);
+
+struct EncodeJob {
+	EncodeFunc encode;
+	const unsigned char *pixels;
+	ImgBuffer *out;
+};
+
+// each job encodes one whole frame, the same way the capture workers do
+static void encode_job(int job, void *cls)
+{
+	EncodeJob *ej = (EncodeJob*)cls;
+	ImgBuffer *out = ej->out + job;
+	out->clear();
+	ej->encode(ej->pixels, FRAME_WIDTH, FRAME_HEIGHT, FRAME_WIDTH * 4, out);
+}
+
+/* synthetic frame: smooth gradients with flat areas and some noise, so that
+ * QOI sees a mix of runs, small differences and literal pixels
+ */
+static void gen_frame(unsigned char *pixels)
+{
+	unsigned int rng = 1;
+	for(int i=0; i<FRAME_HEIGHT; i++) {
+		for(int j=0; j<FRAME_WIDTH; j++) {
+			unsigned char *px = pixels + (i * FRAME_WIDTH + j) * 4;
+			rng = rng * 1664525 + 1013904223;
+			bool flat = ((i >> 6) + (j >> 6)) & 1;
+			int noise = flat ? 0 : (int)(rng >> 29);
+			px[0] = (unsigned char)(j * 255 / FRAME_WIDTH + noise);
+			px[1] = (unsigned char)(i * 255 / FRAME_HEIGHT + noise);
+			px[2] = flat ? 64 : (unsigned char)((i + j) & 0xff);
+			px[3] = 255;
+		}
+	}
+}
+
+void bench_imgenc()
+{
+	static const struct {
+		const char *name;
+		EncodeFunc func;
+	} encoders[] = {
+		{"imgenc png", encode_png},
+		{"imgenc qoi", encode_qoi},
+		{"imgenc raw", encode_raw}
+	};
+
+	MemVector<unsigned char, MEM_MISC>::type pixels(FRAME_WIDTH * FRAME_HEIGHT * 4);
+	gen_frame(&pixels[0]);
+
+	MemVector<ImgBuffer, MEM_MISC>::type bufs(NUM_FRAMES);
+
+	for(int t=0; t<bench_num_thread_counts; t++) {
+		int nthreads = bench_thread_counts[t];
+		init_thread_pool(nthreads);
+		ThreadPool *tpool = get_thread_pool();
+
+		for(int i=0; i<3; i++) {
+			EncodeJob ej;
+			ej.encode = encoders[i].func;
+			ej.pixels = &pixels[0];
+			ej.out = &bufs[0];
+
+			// warm up, and get the output buffers to their full size
+			tpool->run(NUM_FRAMES, encode_job, &ej);
+
+			double t0 = bench_time();
+			tpool->run(NUM_FRAMES, encode_job, &ej);
+			double dt = bench_time() - t0;
+
+			bench_report(encoders[i].name, nthreads, dt / NUM_FRAMES,
+					FRAME_WIDTH * FRAME_HEIGHT / 1e6, "Mpixels");
+			printf("  %d frames/s, %.1f MB per frame\n", (int)(NUM_FRAMES / dt), bufs[0].size() / 1048576.0);
+		}
+	}
+
+	destroy_thread_pool();
+}
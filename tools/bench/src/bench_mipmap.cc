@@ -0,0 +1,75 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include "bench.h"
+#include "mipmap.h"
+#include "thrpool.h"
+
+#define IMAGE_SIZE	2048
+#define NUM_RUNS	5
+
+static const struct {
+	const char *name;
+	int filter;
+	bool srgb;
+} configs[] = {
+	{"mipmap box", MIP_BOX, false},
+	{"mipmap box srgb", MIP_BOX, true},
+	{"mipmap kaiser srgb", MIP_KAISER, true}
+};
+
+/* full mip chain of a 2048x2048 texture, reported in megapixels of the source
+ * image per second. The top levels are split across the thread pool, the
+ * small ones always run on the calling thread.
+ */
+void bench_mipmap()
+{
+	MemVector<unsigned char, MEM_TEXTURES>::type pixels((size_t)IMAGE_SIZE * IMAGE_SIZE * 4);
+	unsigned int rng = 1;
+	for(int i=0; i<IMAGE_SIZE; i++) {
+		for(int j=0; j<IMAGE_SIZE; j++) {
+			unsigned char *px = &pixels[((size_t)i * IMAGE_SIZE + j) * 4];
+			rng = rng * 1664525 + 1013904223;
+			px[0] = (unsigned char)(j >> 3);
+			px[1] = (unsigned char)(i >> 3);
+			px[2] = (unsigned char)(rng >> 24);
+			px[3] = (unsigned char)((i ^ j) & 0xff);
+		}
+	}
+
+	MipChain chain;
+	double mpix = IMAGE_SIZE * IMAGE_SIZE / 1e6;
+
+	for(int t=0; t<bench_num_thread_counts; t++) {
+		int nthreads = bench_thread_counts[t];
+		init_thread_pool(nthreads);
+
+		for(int c=0; c<(int)(sizeof configs / sizeof *configs); c++) {
+			// the first run allocates the chain, and isn't timed
+			gen_mipmaps(&chain, IMAGE_SIZE, IMAGE_SIZE, &pixels[0], configs[c].filter, configs[c].srgb, 0.0f);
+
+			double t0 = bench_time();
+			for(int i=0; i<NUM_RUNS; i++) {
+				gen_mipmaps(&chain, IMAGE_SIZE, IMAGE_SIZE, &pixels[0], configs[c].filter, configs[c].srgb, 0.0f);
+			}
+			bench_report(configs[c].name, nthreads, (bench_time() - t0) / NUM_RUNS, mpix, "MP");
+		}
+	}
+
+	destroy_thread_pool();
+}
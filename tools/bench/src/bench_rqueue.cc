@@ -0,0 +1,108 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include "bench.h"
+#include "rqueue.h"
+#include "thrpool.h"
+
+#define NUM_PACKETS	1000000
+#define NUM_RUNS	10
+
+static unsigned int rng_state = 1;
+
+static unsigned int rng()
+{
+	rng_state = rng_state * 1664525 + 1013904223;
+	return rng_state >> 8;
+}
+
+static unsigned long long make_key(unsigned int pass, unsigned int depth, unsigned int shader,
+		unsigned int material, unsigned int mesh)
+{
+	unsigned long long key = pass;
+	key = (key << D3DUT_RQ_DEPTH_BITS) | depth;
+	key = (key << D3DUT_RQ_SHADER_BITS) | shader;
+	key = (key << D3DUT_RQ_MATERIAL_BITS) | material;
+	key = (key << D3DUT_RQ_MESH_BITS) | mesh;
+	return key;
+}
+
+static void draw(void *cls)
+{
+	++*(int*)cls;
+}
+
+/* one million packets of a plausible scene: draws of a few thousand distinct
+ * objects with far fewer shaders and materials than meshes, in a few passes
+ * with coarse depth buckets
+ */
+#define NUM_OBJECTS	4096
+
+void bench_rqueue()
+{
+	unsigned long long obj_state[NUM_OBJECTS];
+	for(int i=0; i<NUM_OBJECTS; i++) {
+		obj_state[i] = make_key(0, 0, rng() % 64, rng() % 1024, i);
+	}
+
+	MemVector<unsigned long long, MEM_MISC>::type keys(NUM_PACKETS);
+	for(int i=0; i<NUM_PACKETS; i++) {
+		keys[i] = make_key(rng() % 4, rng() % 16, 0, 0, 0) | obj_state[rng() % NUM_OBJECTS];
+	}
+
+	RenderQueue *rq = mem_new<RenderQueue>(MEM_MISC);
+	int draws = 0;
+
+	for(int t=0; t<bench_num_thread_counts; t++) {
+		int nthreads = bench_thread_counts[t];
+		init_thread_pool(nthreads);
+
+		double submit_time = 0.0, sort_time = 0.0, replay_time = 0.0;
+
+		// the first run grows the queue buffers, and isn't timed
+		for(int i=0; i<=NUM_RUNS; i++) {
+			double t0 = bench_time();
+			for(int j=0; j<NUM_PACKETS; j++) {
+				rq->submit(keys[j], draw, &draws);
+			}
+			double t1 = bench_time();
+			rq->sort();
+			double t2 = bench_time();
+			rq->replay();
+			double t3 = bench_time();
+
+			if(i > 0) {
+				submit_time += t1 - t0;
+				sort_time += t2 - t1;
+				replay_time += t3 - t2;
+			}
+			if(i < NUM_RUNS) rq->clear();
+		}
+
+		bench_report("rqueue submit", nthreads, submit_time / NUM_RUNS, NUM_PACKETS / 1e6, "Mpackets");
+		bench_report("rqueue sort", nthreads, sort_time / NUM_RUNS, NUM_PACKETS / 1e6, "Mpackets");
+		bench_report("rqueue replay", nthreads, replay_time / NUM_RUNS, NUM_PACKETS / 1e6, "Mpackets");
+
+		const RQStats &st = rq->get_stats();
+		printf("  state changes: %d sorted, %d unsorted\n", st.state_changes, st.state_changes_unsorted);
+		rq->clear();
+	}
+
+	mem_delete(rq);
+	destroy_thread_pool();
+}
@@ -0,0 +1,95 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* bench - benchmarks of the CPU-side parts of d3dut. Most of them call the
+ * internal modules directly; app goes through the d3dut library and creates
+ * windows, which works without a GPU as d3dut falls back to WARP.
+ * usage: bench [benchmark name]...
+ * With no arguments all benchmarks are run.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include "bench.h"
+#include "timestats.h"
+
+int bench_thread_counts[2];
+int bench_num_thread_counts;
+
+void bench_rqueue();
+void bench_imgenc();
+void bench_mipmap();
+void bench_bcenc();
+void bench_app();
+
+static struct {
+	const char *name;
+	void (*func)();
+} benchmarks[] = {
+	{"rqueue", bench_rqueue},
+	{"imgenc", bench_imgenc},
+	{"mipmap", bench_mipmap},
+	{"bcenc", bench_bcenc},
+	{"app", bench_app},
+	{0, 0}
+};
+
+double bench_time()
+{
+	return (double)ticks_to_nsec(get_timer_ticks()) / 1000000000.0;
+}
+
+void bench_report(const char *name, int nthreads, double sec_per_run, double units_per_run, const char *unit)
+{
+	printf("%-28s %2d thr  %10.3f ms", name, nthreads, sec_per_run * 1000.0);
+	if(units_per_run > 0.0) {
+		printf("  %10.2f %s/s", units_per_run / sec_per_run, unit);
+	}
+	putchar('\n');
+}
+
+int main(int argc, char **argv)
+{
+	init_timer();
+
+	bench_thread_counts[0] = 1;
+	bench_thread_counts[1] = std::thread::hardware_concurrency();
+	bench_num_thread_counts = bench_thread_counts[1] > 1 ? 2 : 1;
+
+	if(argc <= 1) {
+		for(int i=0; benchmarks[i].name; i++) {
+			benchmarks[i].func();
+		}
+		return 0;
+	}
+
+	for(int i=1; i<argc; i++) {
+		int idx = -1;
+		for(int j=0; benchmarks[j].name; j++) {
+			if(strcmp(benchmarks[j].name, argv[i]) == 0) {
+				idx = j;
+				break;
+			}
+		}
+		if(idx == -1) {
+			fprintf(stderr, "unknown benchmark: %s\n", argv[i]);
+			return 1;
+		}
+		benchmarks[idx].func();
+	}
+	return 0;
+}
@@ -0,0 +1,470 @@
+/*
+D3DUT - Simple window creation and event handling for Direct3D 11 applications.
+Copyright (C) 2013  John Tsiombikas <nuclear@member.fsf.org>
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/* objconv - converts Wavefront OBJ files to the d3dut binary mesh format.
+ *
+ * The OBJ file is split into chunks at line boundaries, which are parsed in
+ * parallel. Negative (relative) indices are resolved once the number of
+ * elements in each preceding chunk is known.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <vector>
+#include <map>
+#include <dxgi.h>
+#include "meshfile.h"
+#include "meshopt.h"
+#include "thrpool.h"
+
+// 64-bit file offsets, long is 32 bits on windows
+#ifdef _MSC_VER
+#define ftell64		_ftelli64
+#define fseek64		_fseeki64
+#else
+#define ftell64		ftello
+#define fseek64		fseeko
+#endif
+
+struct Vec3 { float x, y, z; };
+struct Vec2 { float x, y; };
+
+/* face vertex references. Non-negative values are 0-based global indices,
+ * negative values are indices relative to the start of the chunk minus
+ * REL_BIAS, to be fixed up once all chunks are parsed. Relative indices may
+ * point before the start of their chunk. NO_REF means missing.
+ */
+struct FaceVert {
+	int v, vt, vn;
+};
+
+#define NO_REF		(-0x7fffffff - 1)
+#define REL_BIAS	0x40000000
+
+struct Chunk {
+	const char *start, *end;
+
+	std::vector<Vec3> v, vn;
+	std::vector<Vec2> vt;
+	std::vector<FaceVert> fverts;	// triangulated, 3 per triangle
+
+	int base_v, base_vt, base_vn;
+	int line_err;	// first line with a parse error, 0 if none
+};
+
+struct OutVertex {
+	float pos[3];
+	float normal[3];
+	float texcoord[2];
+};
+
+static bool parse_fvert(const char **pp, int nv, int nvt, int nvn, FaceVert *fv);
+static int resolve(int ref, int base, int count);
+
+static const char *usage_fmt = "Usage: %s [options] <input.obj> <output.mesh>\n"
+	"Options:\n"
+	"  -noopt    don't optimize the mesh for the vertex cache\n"
+	"  -t <n>    number of parser threads (default: number of cores)\n"
+	"  -h        print usage and exit\n";
+
+static void parse_job(int job, void *cls)
+{
+	Chunk *chunk = (Chunk*)cls + job;
+	const char *ptr = chunk->start;
+	int line = 0;
+
+	chunk->line_err = 0;
+
+	while(ptr < chunk->end) {
+		const char *eol = ptr;
+		while(eol < chunk->end && *eol != '\n') eol++;
+		line++;
+
+		while(ptr < eol && isspace((unsigned char)*ptr)) ptr++;
+
+		if(ptr + 1 < eol && ptr[0] == 'v' && isspace((unsigned char)ptr[1])) {
+			Vec3 v;
+			if(sscanf(ptr + 2, "%f %f %f", &v.x, &v.y, &v.z) == 3) {
+				chunk->v.push_back(v);
+			} else if(!chunk->line_err) {
+				chunk->line_err = line;
+			}
+
+		} else if(ptr + 2 < eol && ptr[0] == 'v' && ptr[1] == 't' && isspace((unsigned char)ptr[2])) {
+			Vec2 vt;
+			if(sscanf(ptr + 3, "%f %f", &vt.x, &vt.y) == 2) {
+				chunk->vt.push_back(vt);
+			} else if(!chunk->line_err) {
+				chunk->line_err = line;
+			}
+
+		} else if(ptr + 2 < eol && ptr[0] == 'v' && ptr[1] == 'n' && isspace((unsigned char)ptr[2])) {
+			Vec3 vn;
+			if(sscanf(ptr + 3, "%f %f %f", &vn.x, &vn.y, &vn.z) == 3) {
+				chunk->vn.push_back(vn);
+			} else if(!chunk->line_err) {
+				chunk->line_err = line;
+			}
+
+		} else if(ptr + 1 < eol && ptr[0] == 'f' && isspace((unsigned char)ptr[1])) {
+			// triangulate polygons as fans
+			FaceVert first, prev, fv;
+			int count = 0;
+			ptr += 2;
+			for(;;) {
+				while(ptr < eol && isspace((unsigned char)*ptr)) ptr++;
+				if(ptr >= eol) break;
+
+				if(!parse_fvert(&ptr, (int)chunk->v.size(), (int)chunk->vt.size(), (int)chunk->vn.size(), &fv)) {
+					if(!chunk->line_err) chunk->line_err = line;
+					break;
+				}
+				if(count == 0) {
+					first = fv;
+				} else if(count >= 2) {
+					chunk->fverts.push_back(first);
+					chunk->fverts.push_back(prev);
+					chunk->fverts.push_back(fv);
+				}
+				prev = fv;
+				count++;
+			}
+		}
+
+		ptr = eol + 1;
+	}
+}
+
+static bool parse_ref(const char **pp, int count, int *res)
+{
+	char *endp;
+	long val = strtol(*pp, &endp, 10);
+	if(endp == *pp || val == 0) {
+		return false;
+	}
+	*pp = endp;
+
+	if(val > 0) {
+		*res = (int)val - 1;
+	} else {
+		// relative to the last element parsed so far in this chunk
+		*res = count + (int)val - REL_BIAS;
+	}
+	return true;
+}
+
+static bool parse_fvert(const char **pp, int nv, int nvt, int nvn, FaceVert *fv)
+{
+	fv->vt = fv->vn = NO_REF;
+
+	if(!parse_ref(pp, nv, &fv->v)) {
+		return false;
+	}
+	if(**pp == '/') {
+		(*pp)++;
+		if(**pp != '/') {
+			if(!parse_ref(pp, nvt, &fv->vt)) {
+				return false;
+			}
+		}
+		if(**pp == '/') {
+			(*pp)++;
+			if(!parse_ref(pp, nvn, &fv->vn)) {
+				return false;
+			}
+		}
+	}
+	return isspace((unsigned char)**pp) || !**pp;
+}
+
+static int resolve(int ref, int base, int count)
+{
+	if(ref == NO_REF) return -1;
+
+	int idx = ref >= 0 ? ref : base + ref + REL_BIAS;
+	return idx >= 0 && idx < count ? idx : -2;
+}
+
+struct FVertLess {
+	bool operator ()(const FaceVert &a, const FaceVert &b) const
+	{
+		if(a.v != b.v) return a.v < b.v;
+		if(a.vt != b.vt) return a.vt < b.vt;
+		return a.vn < b.vn;
+	}
+};
+
+static void set_attr(MeshFileAttr *attr, const char *semantic, DXGI_FORMAT fmt, unsigned int offs)
+{
+	memset(attr, 0, sizeof *attr);
+	strcpy(attr->semantic, semantic);
+	attr->format = fmt;
+	attr->offset = offs;
+}
+
+static bool write_padding(FILE *fp, long long offs)
+{
+	static const char zeros[MESHFILE_ALIGN] = {0};
+	long long cur = ftell64(fp);
+	return cur <= offs && fwrite(zeros, 1, offs - cur, fp) == (size_t)(offs - cur);
+}
+
+int main(int argc, char **argv)
+{
+	const char *infile = 0, *outfile = 0;
+	bool opt = true;
+	int nthreads = 0;
+
+	for(int i=1; i<argc; i++) {
+		if(argv[i][0] == '-') {
+			if(strcmp(argv[i], "-noopt") == 0) {
+				opt = false;
+			} else if(strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+				nthreads = atoi(argv[++i]);
+			} else if(strcmp(argv[i], "-h") == 0) {
+				printf(usage_fmt, argv[0]);
+				return 0;
+			} else {
+				fprintf(stderr, "invalid option: %s\n", argv[i]);
+				fprintf(stderr, usage_fmt, argv[0]);
+				return 1;
+			}
+		} else if(!infile) {
+			infile = argv[i];
+		} else if(!outfile) {
+			outfile = argv[i];
+		} else {
+			fprintf(stderr, "unexpected argument: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if(!infile || !outfile) {
+		fprintf(stderr, usage_fmt, argv[0]);
+		return 1;
+	}
+
+	// read the whole input file
+	FILE *fp = fopen(infile, "rb");
+	if(!fp) {
+		fprintf(stderr, "failed to open input file: %s\n", infile);
+		return 1;
+	}
+	fseek64(fp, 0, SEEK_END);
+	long long fsize = ftell64(fp);
+	rewind(fp);
+
+	if(fsize < 0 || (unsigned long long)fsize >= (size_t)-1) {
+		fprintf(stderr, "input file too large: %s\n", infile);
+		fclose(fp);
+		return 1;
+	}
+
+	std::vector<char> text((size_t)fsize + 1);
+	if(fsize > 0 && fread(&text[0], 1, (size_t)fsize, fp) != (size_t)fsize) {
+		fprintf(stderr, "failed to read input file: %s\n", infile);
+		fclose(fp);
+		return 1;
+	}
+	fclose(fp);
+	text[fsize] = 0;
+
+	ThreadPool tpool(nthreads);
+
+	// split into roughly equal chunks at line boundaries
+	int nchunks = tpool.get_num_threads() * 4;
+	std::vector<Chunk> chunks(nchunks);
+	const char *ptr = &text[0];
+	const char *text_end = ptr + fsize;
+	for(int i=0; i<nchunks; i++) {
+		chunks[i].start = ptr;
+		const char *end = &text[0] + fsize * (i + 1) / nchunks;
+		if(end < ptr) end = ptr;
+		while(end < text_end && *end != '\n') end++;
+		if(end < text_end) end++;
+		chunks[i].end = i == nchunks - 1 ? text_end : end;
+		ptr = chunks[i].end;
+	}
+
+	tpool.run(nchunks, parse_job, &chunks[0]);
+
+	int nv = 0, nvt = 0, nvn = 0;
+	size_t nfverts = 0;
+	for(int i=0; i<nchunks; i++) {
+		if(chunks[i].line_err) {
+			// chunk-relative line number, count the lines before it
+			int line = chunks[i].line_err;
+			for(const char *p=&text[0]; p<chunks[i].start; p++) {
+				if(*p == '\n') line++;
+			}
+			fprintf(stderr, "%s:%d: parse error\n", infile, line);
+			return 1;
+		}
+		chunks[i].base_v = nv;
+		chunks[i].base_vt = nvt;
+		chunks[i].base_vn = nvn;
+		nv += (int)chunks[i].v.size();
+		nvt += (int)chunks[i].vt.size();
+		nvn += (int)chunks[i].vn.size();
+		nfverts += chunks[i].fverts.size();
+	}
+	if(!nfverts) {
+		fprintf(stderr, "%s: no faces found\n", infile);
+		return 1;
+	}
+
+	std::vector<Vec3> varr, vnarr;
+	std::vector<Vec2> vtarr;
+	varr.reserve(nv);
+	vtarr.reserve(nvt);
+	vnarr.reserve(nvn);
+	for(int i=0; i<nchunks; i++) {
+		varr.insert(varr.end(), chunks[i].v.begin(), chunks[i].v.end());
+		vtarr.insert(vtarr.end(), chunks[i].vt.begin(), chunks[i].vt.end());
+		vnarr.insert(vnarr.end(), chunks[i].vn.begin(), chunks[i].vn.end());
+	}
+
+	// resolve references and merge identical vertices
+	bool have_vt = nvt > 0, have_vn = nvn > 0;
+	std::map<FaceVert, unsigned int, FVertLess> vmap;
+	std::vector<OutVertex> verts;
+	std::vector<unsigned int> indices;
+	indices.reserve(nfverts);
+
+	for(int i=0; i<nchunks; i++) {
+		Chunk *chunk = &chunks[i];
+		for(size_t j=0; j<chunk->fverts.size(); j++) {
+			FaceVert fv;
+			fv.v = resolve(chunk->fverts[j].v, chunk->base_v, nv);
+			fv.vt = resolve(chunk->fverts[j].vt, chunk->base_vt, nvt);
+			fv.vn = resolve(chunk->fverts[j].vn, chunk->base_vn, nvn);
+			if(fv.v < 0 || fv.vt < -1 || fv.vn < -1) {
+				fprintf(stderr, "%s: face index out of range\n", infile);
+				return 1;
+			}
+
+			std::map<FaceVert, unsigned int, FVertLess>::iterator it = vmap.find(fv);
+			if(it != vmap.end()) {
+				indices.push_back(it->second);
+				continue;
+			}
+
+			OutVertex ov;
+			memset(&ov, 0, sizeof ov);
+			memcpy(ov.pos, &varr[fv.v], sizeof ov.pos);
+			if(fv.vn >= 0) {
+				memcpy(ov.normal, &vnarr[fv.vn], sizeof ov.normal);
+			}
+			if(fv.vt >= 0) {
+				ov.texcoord[0] = vtarr[fv.vt].x;
+				ov.texcoord[1] = 1.0f - vtarr[fv.vt].y;	// OBJ origin is bottom-left
+			}
+
+			unsigned int idx = (unsigned int)verts.size();
+			vmap[fv] = idx;
+			verts.push_back(ov);
+			indices.push_back(idx);
+		}
+	}
+
+	if(opt) {
+		optimize_vertex_cache(&indices[0], (int)indices.size(), (int)verts.size());
+		optimize_vertex_fetch(&verts[0], (int)verts.size(), sizeof(OutVertex), &indices[0], (int)indices.size());
+	}
+
+	// pack the attributes which are actually present
+	MeshFileHeader hdr;
+	memset(&hdr, 0, sizeof hdr);
+	memcpy(hdr.magic, MESHFILE_MAGIC, sizeof hdr.magic);
+	hdr.version = MESHFILE_VERSION;
+
+	unsigned int vsize = 0;
+	set_attr(hdr.attr + hdr.num_attr++, "POSITION", DXGI_FORMAT_R32G32B32_FLOAT, vsize);
+	vsize += 12;
+	if(have_vn) {
+		set_attr(hdr.attr + hdr.num_attr++, "NORMAL", DXGI_FORMAT_R32G32B32_FLOAT, vsize);
+		vsize += 12;
+	}
+	if(have_vt) {
+		set_attr(hdr.attr + hdr.num_attr++, "TEXCOORD", DXGI_FORMAT_R32G32_FLOAT, vsize);
+		vsize += 8;
+	}
+
+	hdr.vertex_size = vsize;
+	hdr.num_verts = (uint32_t)verts.size();
+	hdr.index_size = verts.size() <= 65536 ? 2 : 4;
+	hdr.num_indices = (uint32_t)indices.size();
+	hdr.vertex_offs = MESHFILE_ALIGN_OFFS(sizeof hdr);
+	hdr.index_offs = MESHFILE_ALIGN_OFFS(hdr.vertex_offs + (uint64_t)hdr.num_verts * vsize);
+
+	// bounding box, and a bounding sphere around its center
+	for(int i=0; i<3; i++) {
+		hdr.bbox_min[i] = hdr.bbox_max[i] = verts[0].pos[i];
+	}
+	for(size_t i=1; i<verts.size(); i++) {
+		for(int j=0; j<3; j++) {
+			if(verts[i].pos[j] < hdr.bbox_min[j]) hdr.bbox_min[j] = verts[i].pos[j];
+			if(verts[i].pos[j] > hdr.bbox_max[j]) hdr.bbox_max[j] = verts[i].pos[j];
+		}
+	}
+	float max_dsq = 0.0f;
+	for(int i=0; i<3; i++) {
+		hdr.bsph_center[i] = (hdr.bbox_min[i] + hdr.bbox_max[i]) * 0.5f;
+	}
+	for(size_t i=0; i<verts.size(); i++) {
+		float dx = verts[i].pos[0] - hdr.bsph_center[0];
+		float dy = verts[i].pos[1] - hdr.bsph_center[1];
+		float dz = verts[i].pos[2] - hdr.bsph_center[2];
+		float dsq = dx * dx + dy * dy + dz * dz;
+		if(dsq > max_dsq) max_dsq = dsq;
+	}
+	hdr.bsph_radius = sqrt(max_dsq);
+
+	if(!(fp = fopen(outfile, "wb"))) {
+		fprintf(stderr, "failed to open output file: %s\n", outfile);
+		return 1;
+	}
+
+	bool ok = fwrite(&hdr, sizeof hdr, 1, fp) == 1 && write_padding(fp, (long long)hdr.vertex_offs);
+	for(size_t i=0; ok && i<verts.size(); i++) {
+		const OutVertex *v = &verts[i];
+		ok = fwrite(v->pos, sizeof v->pos, 1, fp) == 1 &&
+			(!have_vn || fwrite(v->normal, sizeof v->normal, 1, fp) == 1) &&
+			(!have_vt || fwrite(v->texcoord, sizeof v->texcoord, 1, fp) == 1);
+	}
+	ok = ok && write_padding(fp, (long long)hdr.index_offs);
+	for(size_t i=0; ok && i<indices.size(); i++) {
+		if(hdr.index_size == 2) {
+			unsigned short idx = (unsigned short)indices[i];
+			ok = fwrite(&idx, 2, 1, fp) == 1;
+		} else {
+			ok = fwrite(&indices[i], 4, 1, fp) == 1;
+		}
+	}
+	if(fclose(fp) != 0) {
+		ok = false;
+	}
+	if(!ok) {
+		fprintf(stderr, "failed to write output file: %s\n", outfile);
+		remove(outfile);
+		return 1;
+	}
+
+	printf("%s: %d vertices, %d triangles\n", outfile, (int)hdr.num_verts, (int)hdr.num_indices / 3);
+	return 0;
+}